@@ -22,6 +22,8 @@ src_data_libdata_la_SOURCES = \
 	src/data/case.c \
 	src/data/casegrouper.c \
 	src/data/casegrouper.h \
+	src/data/casebatch.c \
+	src/data/casebatch.h \
 	src/data/caseinit.c \
 	src/data/caseinit.h \
 	src/data/casereader-filter.c \
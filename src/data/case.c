@@ -38,7 +38,26 @@
 #warning "Caseref debug enabled.  CASES ARE NOT BEING SHARED!!"
 #endif
 
+/* Maximum number of destroyed cases that each case prototype keeps
+   for reuse.
+
+   Most code that processes cases destroys each case shortly after it
+   creates the next one, so that a few spare cases are enough to avoid
+   almost all calls to malloc() and free() in a stream of cases with
+   the same prototype.
+
+   The pools are not protected by any lock, so they must be revisited
+   if cases are ever created or destroyed by more than one thread. */
+#define CASE_POOL_SIZE 32
+
+/* Whether destroyed cases are kept for reuse. */
+static bool case_pool_enabled = true;
+
+/* Statistics reported by case_pool_get_stats(). */
+static struct case_pool_stats case_pool_stats;
+
 static size_t case_size (const struct caseproto *);
+static void init_long_strings (struct ccase *, const struct caseproto *);
 static bool variable_matches_case (const struct ccase *,
                                    const struct variable *);
 static void copy_forward (struct ccase *dst, size_t dst_idx,
@@ -67,18 +86,28 @@ case_create (const struct caseproto *proto)
 struct ccase *
 case_try_create (const struct caseproto *proto)
 {
-  struct ccase *c = malloc (case_size (proto));
-  if (c != NULL)
+  struct caseproto *pool = CONST_CAST (struct caseproto *, proto);
+  struct ccase *c;
+
+  if (pool->n_free_cases > 0)
     {
-      if (caseproto_try_init_values (proto, c->values))
-        {
-          c->proto = caseproto_ref (proto);
-          c->ref_cnt = 1;
-          return c;
-        }
-      free (c);
+      /* The long string pointers are still correct, because PROTO
+         discards its free cases whenever it is modified. */
+      c = pool->free_cases[--pool->n_free_cases];
+      case_pool_stats.n_reused++;
+    }
+  else
+    {
+      c = malloc (case_size (proto));
+      if (c == NULL)
+        return NULL;
+      init_long_strings (c, proto);
     }
-  return NULL;
+  case_pool_stats.n_created++;
+
+  c->proto = caseproto_ref (proto);
+  c->ref_cnt = 1;
+  return c;
 }
 
 /* Creates and returns an unshared copy of case C. */
@@ -108,9 +137,7 @@ case_ref (const struct ccase *c_)
 size_t
 case_get_cost (const struct caseproto *proto)
 {
-  /* FIXME: improve approximation? */
-  return (1 + caseproto_get_n_widths (proto)
-          + 3 * caseproto_get_n_long_strings (proto)) * sizeof (union value);
+  return sizeof (union value) + case_size (proto);
 }
 
 /* Changes the prototype for case C, which must not be shared.
@@ -135,12 +162,18 @@ case_resize (struct ccase *c, const struct caseproto *new_proto)
 
   if (old_n_widths != new_n_widths)
     {
-      if (new_n_widths < old_n_widths)
-        caseproto_reinit_values (old_proto, new_proto, c->values);
-      c = xrealloc (c, case_size (new_proto));
-      if (new_n_widths > old_n_widths)
-        caseproto_reinit_values (old_proto, new_proto, c->values);
+      if (caseproto_get_n_long_strings (old_proto)
+          || caseproto_get_n_long_strings (new_proto))
+        {
+          /* The long strings are stored just past the end of the
+             values[] array, so they have to move. */
+          struct ccase *new = case_create (new_proto);
+          case_copy (new, 0, c, 0, MIN (old_n_widths, new_n_widths));
+          case_unref (c);
+          return new;
+        }
 
+      c = xrealloc (c, case_size (new_proto));
       caseproto_unref (old_proto);
       c->proto = caseproto_ref (new_proto);
     }
@@ -449,18 +482,76 @@ case_unshare__ (struct ccase *old)
 void
 case_unref__ (struct ccase *c)
 {
-  caseproto_destroy_values (c->proto, c->values);
-  caseproto_unref (c->proto);
-  free (c);
+  struct caseproto *proto = c->proto;
+
+  /* If C holds the last reference to PROTO, then there is no point
+     in keeping C around, since PROTO is about to be freed. */
+  if (case_pool_enabled && proto->ref_cnt > 1
+      && proto->n_free_cases < CASE_POOL_SIZE)
+    {
+      if (proto->free_cases == NULL)
+        proto->free_cases = xnmalloc (CASE_POOL_SIZE,
+                                      sizeof *proto->free_cases);
+      proto->free_cases[proto->n_free_cases++] = c;
+      case_pool_stats.n_pooled++;
+    }
+  else
+    free (c);
+  caseproto_unref (proto);
+}
+
+/* Enables or disables keeping destroyed cases for reuse by later
+   calls to case_create() with the same case prototype.  Cases that
+   have already been kept are still reused after disabling. */
+void
+case_pool_set_enabled (bool enabled)
+{
+  case_pool_enabled = enabled;
+}
+
+/* Returns true if destroyed cases are kept for reuse, false
+   otherwise. */
+bool
+case_pool_is_enabled (void)
+{
+  return case_pool_enabled;
+}
+
+/* Stores statistics on the cases created so far into STATS. */
+void
+case_pool_get_stats (struct case_pool_stats *stats)
+{
+  *stats = case_pool_stats;
 }
 
 /* Returns the number of bytes needed by a case for case
-   prototype PROTO. */
+   prototype PROTO, including the data for its long string
+   values. */
 static size_t
 case_size (const struct caseproto *proto)
 {
   return (offsetof (struct ccase, values)
-          + caseproto_get_n_widths (proto) * sizeof (union value));
+          + caseproto_get_n_widths (proto) * sizeof (union value)
+          + caseproto_get_long_strings_size (proto));
+}
+
+/* Points each of the long string values in C, whose prototype is
+   PROTO, to its own part of the memory that follows C's values[]
+   array. */
+static void
+init_long_strings (struct ccase *c, const struct caseproto *proto)
+{
+  size_t n_long_strings = caseproto_get_n_long_strings (proto);
+  uint8_t *data;
+  size_t i;
+
+  data = (uint8_t *) &c->values[caseproto_get_n_widths (proto)];
+  for (i = 0; i < n_long_strings; i++)
+    {
+      size_t idx = caseproto_get_long_string_idx (proto, i);
+      c->values[idx].long_string = data;
+      data += caseproto_get_width (proto, idx);
+    }
 }
 
 /* Returns true if C contains a value at V's case index with the
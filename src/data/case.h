@@ -49,7 +49,15 @@ typedef long int casenumber;
    keeping the reference count is to make a virtual copy of the
    case, this is undesirable behavior.  The case_unshare function
    provides a solution, by making a new, unshared copy of a
-   shared case. */
+   shared case.
+
+   A case is allocated as a single block of memory.  The data for
+   long string values, if any, follow the values[] array in the
+   same block, so that creating and destroying a case requires
+   only a single call to malloc() and free(), no matter how many
+   long string values it contains.  Thus, the values in a case
+   must never be passed to value_init(), value_destroy(),
+   value_resize(), or value_swap(). */
 struct ccase
   {
     struct caseproto *proto;    /* Case prototype. */
@@ -71,6 +79,18 @@ static inline const struct caseproto *case_get_proto (const struct ccase *);
 
 size_t case_get_cost (const struct caseproto *);
 
+/* Statistics on case allocation, for debugging and tuning. */
+struct case_pool_stats
+  {
+    unsigned long long int n_created; /* Cases created. */
+    unsigned long long int n_reused;  /* Created cases taken from a pool. */
+    unsigned long long int n_pooled;  /* Destroyed cases kept for reuse. */
+  };
+
+void case_pool_set_enabled (bool);
+bool case_pool_is_enabled (void);
+void case_pool_get_stats (struct case_pool_stats *);
+
 struct ccase *case_resize (struct ccase *, const struct caseproto *)
   WARN_UNUSED_RESULT;
 struct ccase *case_unshare_and_resize (struct ccase *,
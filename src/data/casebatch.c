@@ -0,0 +1,146 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include "data/casebatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpspp/assertion.h"
+
+#include "gl/xalloc.h"
+
+/* Creates and returns a new, empty casebatch that can hold up to
+   CAPACITY cases with the given PROTO.  CAPACITY must be positive.
+
+   The caller retains ownership of PROTO. */
+struct casebatch *
+casebatch_create (const struct caseproto *proto, size_t capacity)
+{
+  size_t n_widths = caseproto_get_n_widths (proto);
+  struct casebatch *batch;
+  size_t i;
+
+  assert (capacity > 0);
+
+  batch = xmalloc (sizeof *batch);
+  batch->proto = caseproto_ref (proto);
+  batch->n_cases = 0;
+  batch->capacity = capacity;
+  batch->columns = xnmalloc (n_widths, sizeof *batch->columns);
+  for (i = 0; i < n_widths; i++)
+    {
+      int width = caseproto_get_width (proto, i);
+      batch->columns[i] = (width == 0 ? xnmalloc (capacity, sizeof (double))
+                           : width > 0 ? xnmalloc (capacity, width)
+                           : NULL);
+    }
+  return batch;
+}
+
+/* Destroys BATCH. */
+void
+casebatch_destroy (struct casebatch *batch)
+{
+  if (batch != NULL)
+    {
+      size_t n_widths = caseproto_get_n_widths (batch->proto);
+      size_t i;
+
+      for (i = 0; i < n_widths; i++)
+        free (batch->columns[i]);
+      free (batch->columns);
+      caseproto_unref (batch->proto);
+      free (batch);
+    }
+}
+
+/* Removes all of the cases from BATCH. */
+void
+casebatch_clear (struct casebatch *batch)
+{
+  batch->n_cases = 0;
+}
+
+/* Removes all but the first N_CASES cases from BATCH.  Has no effect
+   if BATCH has N_CASES cases or fewer. */
+void
+casebatch_truncate (struct casebatch *batch, size_t n_cases)
+{
+  if (n_cases < batch->n_cases)
+    batch->n_cases = n_cases;
+}
+
+/* Adds a case to the end of BATCH, which must not be full, and returns
+   the new case's row number.  The values in the new row have
+   indeterminate contents until the caller writes them.
+
+   This is useful for casereaders that decode data directly into a
+   batch. */
+size_t
+casebatch_add_row (struct casebatch *batch)
+{
+  assert (!casebatch_is_full (batch));
+  return batch->n_cases++;
+}
+
+/* Returns the string value in column IDX, which must be a string
+   column, of row ROW in BATCH.  The string is not null-terminated and
+   the caller must not modify it. */
+const uint8_t *
+casebatch_str (const struct casebatch *batch, size_t idx, size_t row)
+{
+  int width = caseproto_get_width (batch->proto, idx);
+
+  assert (width > 0);
+  assert (row < batch->capacity);
+  return (const uint8_t *) batch->columns[idx] + row * width;
+}
+
+/* Returns the string value in column IDX, which must be a string
+   column, of row ROW in BATCH, for modification.  The string is not
+   null-terminated. */
+uint8_t *
+casebatch_str_rw (struct casebatch *batch, size_t idx, size_t row)
+{
+  int width = caseproto_get_width (batch->proto, idx);
+
+  assert (width > 0);
+  assert (row < batch->capacity);
+  return (uint8_t *) batch->columns[idx] + row * width;
+}
+
+/* Appends a copy of the data in case C to BATCH, which must not be
+   full.  C must have at least as many values as BATCH's prototype,
+   and those values must have the same widths. */
+void
+casebatch_append_case (struct casebatch *batch, const struct ccase *c)
+{
+  size_t n_widths = caseproto_get_n_widths (batch->proto);
+  size_t row = casebatch_add_row (batch);
+  size_t i;
+
+  for (i = 0; i < n_widths; i++)
+    {
+      int width = caseproto_get_width (batch->proto, i);
+      if (width == 0)
+        ((double *) batch->columns[i])[row] = case_num_idx (c, i);
+      else if (width > 0)
+        memcpy (casebatch_str_rw (batch, i, row), case_str_idx (c, i), width);
+    }
+}
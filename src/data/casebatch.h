@@ -0,0 +1,131 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Column-oriented batch of cases.
+
+   A casebatch holds a block of up to a fixed number of cases, all
+   with the same case prototype, stored column by column instead of
+   case by case: each numeric value in the prototype has an array of
+   doubles with one element per case, and each string value has a
+   single block of memory that holds its string for every case, one
+   after another.
+
+   Reading cases a batch at a time with casereader_read_batch()
+   avoids the cost of creating, reference counting, and destroying a
+   "struct ccase" for every case, and allows code that processes one
+   variable at a time to run over contiguous arrays.
+
+   Rows are numbered from 0 within a batch.  Columns are numbered
+   the same way as the values in the batch's case prototype. */
+
+#ifndef DATA_CASEBATCH_H
+#define DATA_CASEBATCH_H 1
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "data/case.h"
+
+struct caseproto;
+
+/* A batch of cases, stored by column.
+
+   This structure is semi-opaque: clients may read 'n_cases'
+   through casebatch_get_n_cases() and should use the other
+   accessor functions for everything else. */
+struct casebatch
+  {
+    struct caseproto *proto;    /* Prototype of the cases in the batch. */
+    size_t n_cases;             /* Number of cases in the batch. */
+    size_t capacity;            /* Maximum number of cases. */
+    void **columns;             /* One array per value in 'proto'. */
+  };
+
+struct casebatch *casebatch_create (const struct caseproto *,
+                                    size_t capacity);
+void casebatch_destroy (struct casebatch *);
+
+static inline const struct caseproto *casebatch_get_proto (
+  const struct casebatch *);
+static inline size_t casebatch_get_n_cases (const struct casebatch *);
+static inline size_t casebatch_get_capacity (const struct casebatch *);
+static inline bool casebatch_is_full (const struct casebatch *);
+
+void casebatch_clear (struct casebatch *);
+void casebatch_truncate (struct casebatch *, size_t n_cases);
+size_t casebatch_add_row (struct casebatch *);
+
+static inline const double *casebatch_num_column (const struct casebatch *,
+                                                  size_t idx);
+static inline double *casebatch_num_column_rw (struct casebatch *,
+                                               size_t idx);
+const uint8_t *casebatch_str (const struct casebatch *,
+                              size_t idx, size_t row);
+uint8_t *casebatch_str_rw (struct casebatch *, size_t idx, size_t row);
+
+void casebatch_append_case (struct casebatch *, const struct ccase *);
+
+/* Returns the prototype of the cases in BATCH. */
+static inline const struct caseproto *
+casebatch_get_proto (const struct casebatch *batch)
+{
+  return batch->proto;
+}
+
+/* Returns the number of cases in BATCH. */
+static inline size_t
+casebatch_get_n_cases (const struct casebatch *batch)
+{
+  return batch->n_cases;
+}
+
+/* Returns the maximum number of cases that BATCH can hold. */
+static inline size_t
+casebatch_get_capacity (const struct casebatch *batch)
+{
+  return batch->capacity;
+}
+
+/* Returns true if BATCH holds as many cases as it can. */
+static inline bool
+casebatch_is_full (const struct casebatch *batch)
+{
+  return batch->n_cases >= batch->capacity;
+}
+
+/* Returns the array of numeric values in column IDX of BATCH, which
+   must be numeric.  The array has casebatch_get_n_cases(BATCH)
+   valid elements. */
+static inline const double *
+casebatch_num_column (const struct casebatch *batch, size_t idx)
+{
+  assert (caseproto_get_width (batch->proto, idx) == 0);
+  return batch->columns[idx];
+}
+
+/* Returns the array of numeric values in column IDX of BATCH, which
+   must be numeric, for modification.  The array has room for
+   casebatch_get_capacity(BATCH) elements. */
+static inline double *
+casebatch_num_column_rw (struct casebatch *batch, size_t idx)
+{
+  assert (caseproto_get_width (batch->proto, idx) == 0);
+  return batch->columns[idx];
+}
+
+#endif /* data/casebatch.h */
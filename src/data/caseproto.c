@@ -35,6 +35,7 @@ static void destroy_long_strings (const struct caseproto *,
                                   size_t first, size_t last, union value[]);
 static size_t count_long_strings (const struct caseproto *,
                                   size_t idx, size_t count);
+static void discard_free_cases (struct caseproto *);
 
 /* Returns the number of bytes to allocate for a struct caseproto
    with room for N_WIDTHS elements in its widths[] array. */
@@ -55,6 +56,9 @@ caseproto_create (void)
   proto->ref_cnt = 1;
   proto->long_strings = NULL;
   proto->n_long_strings = 0;
+  proto->long_strings_size = 0;
+  proto->free_cases = NULL;
+  proto->n_free_cases = 0;
   proto->n_widths = 0;
   proto->allocated_widths = N_ALLOCATE;
   return proto;
@@ -314,6 +318,7 @@ caseproto_copy (const struct caseproto *proto, size_t idx, size_t count,
 void
 caseproto_free__ (struct caseproto *proto)
 {
+  discard_free_cases (proto);
   free (proto->long_strings);
   free (proto);
 }
@@ -329,10 +334,14 @@ caseproto_refresh_long_string_cache__ (const struct caseproto *proto_)
 
   proto->long_strings = xmalloc (proto->n_long_strings
                                  * sizeof *proto->long_strings);
+  proto->long_strings_size = 0;
   n = 0;
   for (i = 0; i < proto->n_widths; i++)
     if (proto->widths[i] > MAX_SHORT_STRING)
-      proto->long_strings[n++] = i;
+      {
+        proto->long_strings[n++] = i;
+        proto->long_strings_size += proto->widths[i];
+      }
   assert (n == proto->n_long_strings);
 }
 
@@ -344,12 +353,16 @@ caseproto_unshare (struct caseproto *old)
     {
       new = xmemdup (old, caseproto_size (old->allocated_widths));
       new->ref_cnt = 1;
+      new->free_cases = NULL;
+      new->n_free_cases = 0;
       --old->ref_cnt;
     }
   else
     {
+      /* Cached cases have the wrong size for the modified prototype. */
       new = old;
       free (new->long_strings);
+      discard_free_cases (new);
     }
   new->long_strings = NULL;
   return new;
@@ -400,6 +413,21 @@ destroy_long_strings (const struct caseproto *proto, size_t first, size_t last,
     }
 }
 
+/* Frees the cases that PROTO is holding for reuse by case_create().
+   These are plain blocks of memory, because each case's long strings
+   are part of the same allocation as the case itself. */
+static void
+discard_free_cases (struct caseproto *proto)
+{
+  size_t i;
+
+  for (i = 0; i < proto->n_free_cases; i++)
+    free (proto->free_cases[i]);
+  free (proto->free_cases);
+  proto->free_cases = NULL;
+  proto->n_free_cases = 0;
+}
+
 static size_t
 count_long_strings (const struct caseproto *proto, size_t idx, size_t count)
 {
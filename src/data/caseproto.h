@@ -69,6 +69,13 @@ struct caseproto
        the former must be regenerated. */
     size_t *long_strings;       /* Array of indexes of long string widths. */
     size_t n_long_strings;      /* Number of long string widths. */
+    size_t long_strings_size;   /* Sum of the long string widths. */
+
+    /* Cases with this prototype that have been destroyed, kept for
+       reuse by case_create().  Maintained by case.c.  These do not
+       hold references to the prototype. */
+    struct ccase **free_cases;
+    size_t n_free_cases;
 
     /* Widths. */
     size_t n_widths;            /* Number of widths. */
@@ -76,6 +83,7 @@ struct caseproto
     short int widths[1];        /* Width of each case value. */
   };
 
+struct ccase;
 struct pool;
 
 /* Creation and destruction. */
@@ -126,6 +134,8 @@ void caseproto_copy (const struct caseproto *, size_t idx, size_t count,
 static inline size_t caseproto_get_n_long_strings (const struct caseproto *);
 static inline size_t caseproto_get_long_string_idx (const struct caseproto *,
                                                     size_t idx1);
+static inline size_t caseproto_get_long_strings_size (
+  const struct caseproto *);
 
 /* For use in assertions. */
 bool caseproto_range_is_valid (const struct caseproto *,
@@ -208,4 +218,19 @@ caseproto_get_long_string_idx (const struct caseproto *proto, size_t idx1)
   return proto->long_strings[idx1];
 }
 
+/* Returns the total number of bytes in all of the long string widths in
+   PROTO, that is, the amount of memory needed to store the strings for all
+   of the long string values in a case with prototype PROTO. */
+static inline size_t
+caseproto_get_long_strings_size (const struct caseproto *proto)
+{
+  if (proto->n_long_strings == 0)
+    return 0;
+
+  if (proto->long_strings == NULL)
+    caseproto_refresh_long_string_cache__ (proto);
+
+  return proto->long_strings_size;
+}
+
 #endif /* data/caseproto.h */
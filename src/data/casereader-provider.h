@@ -108,6 +108,24 @@ struct casereader_class
        casereader_force_error on READER. */
     struct ccase *(*peek) (struct casereader *reader, void *aux,
                            casenumber idx);
+
+    /* Optional: if the data source can decode cases directly into
+       a column-oriented batch, supply this function as an
+       optimization for use by casereader_read_batch.  If it is
+       null, casereader_read_batch falls back to calling "read"
+       once per case.
+
+       Appends up to MAX_CASES cases from READER to BATCH, which
+       has room for at least that many, and advances READER past
+       them.  Returns the number of cases appended.  Returning
+       fewer than MAX_CASES indicates end of file or an I/O
+       error, after which neither this function nor "read" will
+       be called again for the given READER.
+
+       If an I/O error occurs, this function should call
+       casereader_force_error on READER. */
+    size_t (*read_batch) (struct casereader *reader, void *aux,
+                          struct casebatch *batch, size_t max_cases);
   };
 
 struct casereader *
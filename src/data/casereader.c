@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 
+#include "data/casebatch.h"
 #include "data/casereader-shim.h"
 #include "data/casewriter.h"
 #include "libpspp/assertion.h"
@@ -82,6 +83,54 @@ casereader_read (struct casereader *reader)
   return NULL;
 }
 
+/* Clears BATCH, which must have the same case prototype as READER,
+   then reads as many cases from READER into it as it can hold.
+   Returns the number of cases read, which is less than BATCH's
+   capacity only at end of file or upon an I/O error, and 0 if there
+   are no cases left to read.
+
+   Reading a batch of cases is equivalent to calling casereader_read
+   once per case, but it can be much faster for casereaders that
+   decode their data directly into a batch. */
+size_t
+casereader_read_batch (struct casereader *reader, struct casebatch *batch)
+{
+  size_t max_cases;
+  size_t n;
+
+  casebatch_clear (batch);
+  max_cases = casebatch_get_capacity (batch);
+  if (reader->case_cnt < (casenumber) max_cases)
+    max_cases = reader->case_cnt;
+  if (max_cases == 0)
+    return 0;
+
+  expensive_assert (caseproto_equal (casebatch_get_proto (batch), 0,
+                                     reader->proto, 0,
+                                     caseproto_get_n_widths (reader->proto)));
+  if (reader->class->read_batch != NULL)
+    {
+      n = reader->class->read_batch (reader, reader->aux, batch, max_cases);
+      assert (n <= max_cases);
+      if (reader->case_cnt != CASENUMBER_MAX)
+        reader->case_cnt -= n;
+      if (n < max_cases)
+        reader->case_cnt = 0;
+    }
+  else
+    {
+      for (n = 0; n < max_cases; n++)
+        {
+          struct ccase *c = casereader_read (reader);
+          if (c == NULL)
+            break;
+          casebatch_append_case (batch, c);
+          case_unref (c);
+        }
+    }
+  return n;
+}
+
 /* Destroys READER.
    Returns false if an I/O error was detected on READER, true
    otherwise. */
@@ -55,12 +55,14 @@
 #include "data/case.h"
 #include "data/missing-values.h"
 
+struct casebatch;
 struct dictionary;
 struct casereader;
 struct casewriter;
 struct subcase;
 
 struct ccase *casereader_read (struct casereader *);
+size_t casereader_read_batch (struct casereader *, struct casebatch *);
 bool casereader_destroy (struct casereader *);
 
 struct casereader *casereader_clone (const struct casereader *);
@@ -29,13 +29,15 @@
 #include "data/casereader.h"
 #include "data/casereader-provider.h"
 #include "data/casereader-shim.h"
+#include "data/caseproto.h"
 #include "data/casewriter.h"
 #include "data/dictionary.h"
 #include "data/file-handle-def.h"
 #include "data/session.h"
 #include "data/transformations.h"
+#include "data/value.h"
 #include "data/variable.h"
-#include "libpspp/deque.h"
+#include "libpspp/assertion.h"
 #include "libpspp/misc.h"
 #include "libpspp/str.h"
 #include "libpspp/taint.h"
@@ -85,10 +87,12 @@ struct dataset {
   /* Time at which proc was last invoked. */
   time_t last_proc_invocation;
 
-  /* Cases just before ("lagging") the current one. */
-  int n_lag;			/* Number of cases to lag. */
-  struct deque lag;             /* Deque of lagged cases. */
-  struct ccase **lag_cases;     /* Lagged cases managed by deque. */
+  /* Values of variables in the cases just before ("lagging") the
+     current one. */
+  struct lag_var *lag_vars;     /* Variables whose values to lag. */
+  size_t n_lag_vars;            /* Number of variables in lag_vars. */
+  size_t allocated_lag_vars;    /* Allocated elements in lag_vars. */
+  casenumber n_lagged;          /* Number of cases lagged so far. */
 
   /* Procedure data. */
   enum
@@ -110,7 +114,25 @@ struct dataset {
   unsigned int seqno;
 };
 
+/* A variable whose values in past cases are needed for LAG.
+
+   The variable is identified by its case index and width, not by a
+   pointer to it, because the command that registered it may fail and
+   delete it before the next procedure runs. */
+struct lag_var
+  {
+    int case_index;             /* The variable's case index. */
+    int width;                  /* The variable's width. */
+    int n_lag;                  /* Number of past values to keep. */
+    union value *values;        /* Ring buffer of N_LAG past values, or
+                                   NULL if the variable no longer exists. */
+  };
+
 static void dataset_changed__ (struct dataset *);
+static void init_lags (struct dataset *);
+static void push_lags (struct dataset *, const struct ccase *);
+static void destroy_lags (struct dataset *);
+static void clear_lags (struct dataset *);
 static void dataset_transformations_changed__ (struct dataset *,
                                                bool non_empty);
 
@@ -203,6 +225,7 @@ dataset_destroy (struct dataset *ds)
       caseinit_destroy (ds->caseinit);
       trns_chain_destroy (ds->permanent_trns_chain);
       dataset_transformations_changed__ (ds, false);
+      free (ds->lag_vars);
       free (ds->name);
       free (ds);
     }
@@ -217,7 +240,7 @@ dataset_clear (struct dataset *ds)
   dict_clear (ds->dict);
   fh_set_default_handle (NULL);
 
-  ds->n_lag = 0;
+  clear_lags (ds);
 
   casereader_destroy (ds->source);
   ds->source = NULL;
@@ -391,7 +414,7 @@ proc_execute (struct dataset *ds)
        || trns_chain_is_empty (ds->temporary_trns_chain))
       && trns_chain_is_empty (ds->permanent_trns_chain))
     {
-      ds->n_lag = 0;
+      clear_lags (ds);
       ds->discard_output = false;
       dict_set_case_limit (ds->dict, 0);
       dict_clear_vectors (ds->dict);
@@ -458,8 +481,8 @@ proc_open_filtering (struct dataset *ds, bool filter)
       ds->sink = NULL;
     }
 
-  /* Allocate memory for lagged cases. */
-  ds->lag_cases = deque_init (&ds->lag, ds->n_lag, sizeof *ds->lag_cases);
+  /* Allocate memory for lagged values. */
+  init_lags (ds);
 
   ds->proc_state = PROC_OPEN;
   ds->cases_written = 0;
@@ -533,13 +556,9 @@ proc_casereader_read (struct casereader *reader UNUSED, void *ds_)
       if (retval != TRNS_CONTINUE)
         continue;
 
-      /* Write case to collection of lagged cases. */
-      if (ds->n_lag > 0)
-        {
-          while (deque_count (&ds->lag) >= ds->n_lag)
-            case_unref (ds->lag_cases[deque_pop_back (&ds->lag)]);
-          ds->lag_cases[deque_push_front (&ds->lag)] = case_ref (c);
-        }
+      /* Save the values that LAG will need later. */
+      if (ds->n_lag_vars > 0)
+        push_lags (ds, c);
 
       /* Write case to replacement dataset. */
       ds->cases_written++;
@@ -600,10 +619,8 @@ proc_commit (struct dataset *ds)
 
   dataset_changed__ (ds);
 
-  /* Free memory for lagged cases. */
-  while (!deque_is_empty (&ds->lag))
-    case_unref (ds->lag_cases[deque_pop_back (&ds->lag)]);
-  free (ds->lag_cases);
+  /* Free memory for lagged values. */
+  destroy_lags (ds);
 
   /* Dictionary from before TEMPORARY becomes permanent. */
   proc_cancel_temporary_transformations (ds);
@@ -655,18 +672,24 @@ update_last_proc_invocation (struct dataset *ds)
   ds->last_proc_invocation = time (NULL);
 }
 
-/* Returns a pointer to the lagged case from N_BEFORE cases before the
-   current one, or NULL if there haven't been that many cases yet. */
-const struct ccase *
-lagged_case (const struct dataset *ds, int n_before)
+/* Returns the value, in the case N_BEFORE cases before the current
+   one, of the variable that dataset_need_lag() returned LAG_IDX for,
+   or NULL if there haven't been that many cases yet.  The variable
+   must have been registered for at least N_BEFORE cases. */
+const union value *
+lagged_value (const struct dataset *ds, size_t lag_idx, int n_before)
 {
-  assert (n_before >= 1);
-  assert (n_before <= ds->n_lag);
+  const struct lag_var *lv;
 
-  if (n_before <= deque_count (&ds->lag))
-    return ds->lag_cases[deque_front (&ds->lag, n_before - 1)];
-  else
-    return NULL;
+  assert (n_before >= 1);
+  assert (lag_idx < ds->n_lag_vars);
+
+  lv = &ds->lag_vars[lag_idx];
+  assert (lv->values != NULL);
+  assert (n_before <= lv->n_lag);
+  return (n_before <= ds->n_lagged
+          ? &lv->values[(ds->n_lagged - n_before) % lv->n_lag]
+          : NULL);
 }
 
 /* Returns the current set of permanent transformations,
@@ -807,6 +830,7 @@ proc_cancel_all_transformations (struct dataset *ds)
   ok = trns_chain_destroy (ds->temporary_trns_chain) && ok;
   ds->permanent_trns_chain = ds->cur_trns_chain = trns_chain_create ();
   ds->temporary_trns_chain = NULL;
+  clear_lags (ds);
   dataset_transformations_changed__ (ds, false);
 
   return ok;
@@ -949,10 +973,132 @@ filter_trns_proc (void *filter_var_,
 }
 
 
-void
-dataset_need_lag (struct dataset *ds, int n_before)
+/* Arranges for the values of VAR in the N_BEFORE cases before the
+   current one to be available through lagged_value() while the
+   permanent transformations in DS execute.  Only the lagged values of
+   the variables registered this way are kept, not whole cases.
+
+   Returns the index to pass to lagged_value() to obtain VAR's lagged
+   values.  The index remains valid until the transformations are
+   cleared.
+
+   Registrations last until the transformations are cleared.  A
+   registration made by a command that then fails is harmless: the
+   next procedure ignores it if its variable no longer exists. */
+size_t
+dataset_need_lag (struct dataset *ds, const struct variable *var,
+                  int n_before)
+{
+  int case_index = var_get_case_index (var);
+  int width = var_get_width (var);
+  struct lag_var *lv;
+  size_t i;
+
+  assert (n_before >= 1);
+
+  for (i = 0; i < ds->n_lag_vars; i++)
+    {
+      lv = &ds->lag_vars[i];
+      if (lv->case_index == case_index)
+        {
+          if (lv->width != width)
+            {
+              /* The variable that registered this case index before
+                 was deleted. */
+              lv->width = width;
+              lv->n_lag = n_before;
+            }
+          else
+            lv->n_lag = MAX (lv->n_lag, n_before);
+          return i;
+        }
+    }
+
+  if (ds->n_lag_vars >= ds->allocated_lag_vars)
+    ds->lag_vars = x2nrealloc (ds->lag_vars, &ds->allocated_lag_vars,
+                               sizeof *ds->lag_vars);
+  lv = &ds->lag_vars[ds->n_lag_vars++];
+  lv->case_index = case_index;
+  lv->width = width;
+  lv->n_lag = n_before;
+  lv->values = NULL;
+  return ds->n_lag_vars - 1;
+}
+
+/* Allocates the ring buffers for the variables registered with
+   dataset_need_lag(), for use by a procedure.  Skips registrations for
+   variables that are no longer in DS's dictionary, that is, whose case
+   index no longer holds a value of the registered width, leaving them
+   in place so that the indexes of the others stay valid. */
+static void
+init_lags (struct dataset *ds)
+{
+  const struct caseproto *proto = dict_get_proto (ds->dict);
+  size_t n_widths = caseproto_get_n_widths (proto);
+  size_t i;
+
+  for (i = 0; i < ds->n_lag_vars; i++)
+    {
+      struct lag_var *lv = &ds->lag_vars[i];
+      int k;
+
+      if (lv->case_index >= n_widths
+          || caseproto_get_width (proto, lv->case_index) != lv->width)
+        continue;
+
+      lv->values = xnmalloc (lv->n_lag, sizeof *lv->values);
+      for (k = 0; k < lv->n_lag; k++)
+        value_init (&lv->values[k], lv->width);
+    }
+  ds->n_lagged = 0;
+}
+
+/* Saves the values in C of the variables registered with
+   dataset_need_lag(), overwriting the oldest saved values. */
+static void
+push_lags (struct dataset *ds, const struct ccase *c)
+{
+  size_t i;
+
+  for (i = 0; i < ds->n_lag_vars; i++)
+    {
+      struct lag_var *lv = &ds->lag_vars[i];
+      if (lv->values != NULL)
+        value_copy (&lv->values[ds->n_lagged % lv->n_lag],
+                    case_data_idx (c, lv->case_index), lv->width);
+    }
+  ds->n_lagged++;
+}
+
+/* Frees the ring buffers allocated by init_lags(). */
+static void
+destroy_lags (struct dataset *ds)
+{
+  size_t i;
+
+  for (i = 0; i < ds->n_lag_vars; i++)
+    {
+      struct lag_var *lv = &ds->lag_vars[i];
+
+      if (lv->values != NULL)
+        {
+          int j;
+
+          for (j = 0; j < lv->n_lag; j++)
+            value_destroy (&lv->values[j], lv->width);
+          free (lv->values);
+          lv->values = NULL;
+        }
+    }
+  ds->n_lagged = 0;
+}
+
+/* Forgets all of the variables registered with dataset_need_lag(). */
+static void
+clear_lags (struct dataset *ds)
 {
-  ds->n_lag = MAX (ds->n_lag, n_before);
+  destroy_lags (ds);
+  ds->n_lag_vars = 0;
 }
 
 static void
@@ -26,6 +26,8 @@ struct casereader;
 struct dataset;
 struct dictionary;
 struct session;
+struct variable;
+union value;
 
 struct dataset *dataset_create (struct session *, const char *);
 struct dataset *dataset_clone (struct dataset *, const char *);
@@ -109,8 +111,10 @@ bool proc_commit (struct dataset *);
 
 bool dataset_end_of_command (struct dataset *);
 
-const struct ccase *lagged_case (const struct dataset *ds, int n_before);
-void dataset_need_lag (struct dataset *ds, int n_before);
+const union value *lagged_value (const struct dataset *ds, size_t lag_idx,
+                                 int n_before);
+size_t dataset_need_lag (struct dataset *ds, const struct variable *var,
+                         int n_before);
 
 /* Private interface for use by session code. */
 
@@ -58,6 +58,7 @@ static unsigned long int axis_extend (struct axis *, unsigned long int width);
 static unsigned long int axis_map (const struct axis *, unsigned long log_pos);
 
 static unsigned long axis_get_size (const struct axis *);
+static size_t axis_count_groups (const struct axis *);
 static void axis_insert (struct axis *,
                          unsigned long int log_start,
                          unsigned long int phy_start,
@@ -111,6 +112,7 @@ struct source
     struct sparse_xarray *data; /* Data at top level, atop the backing. */
     struct casereader *backing; /* Backing casereader (or null). */
     casenumber backing_rows;    /* Number of rows in backing (if backed). */
+    casenumber backing_read;    /* Rows of backing already read ahead. */
     size_t n_used;              /* Number of column in use (if backed). */
   };
 
@@ -153,6 +155,8 @@ enum rw_op
 
 static void allocate_column (struct datasheet *, int width, struct column *);
 static void release_source (struct datasheet *, struct source *);
+static bool needs_compaction (const struct datasheet *);
+static bool compact_datasheet (struct datasheet *);
 static bool rw_case (struct datasheet *ds, enum rw_op op,
                      casenumber lrow, size_t start_column, size_t n_columns,
                      union value data[]);
@@ -676,6 +680,45 @@ datasheet_delete_rows (struct datasheet *ds,
   axis_remove (ds->rows, first, cnt);
 }
 
+/* Reads ahead up to N_ROWS more rows from the casereader that backs
+   DS, if any, so that later accesses to those rows do not have to
+   wait for them, and every row before them, to be decoded.  Intended
+   to be called repeatedly while otherwise idle, e.g. from a GUI idle
+   handler.
+
+   Returns true if rows remain to be read ahead, false if DS has no
+   backing casereader or all of its rows have been read (or an I/O
+   error occurred). */
+bool
+datasheet_read_ahead (struct datasheet *ds, casenumber n_rows)
+{
+  struct source *source;
+  casenumber last;
+  struct ccase *c;
+
+  assert (n_rows > 0);
+
+  if (ds->n_sources == 0 || !source_has_backing (ds->sources[0]))
+    return false;
+
+  /* Only the first source ever has a backing casereader. */
+  source = ds->sources[0];
+  if (source->backing_read >= source->backing_rows)
+    return false;
+
+  last = MIN (source->backing_rows - 1, source->backing_read + n_rows - 1);
+  c = casereader_peek (source->backing, last);
+  if (c == NULL)
+    {
+      source->backing_read = source->backing_rows;
+      return false;
+    }
+  case_unref (c);
+
+  source->backing_read = last + 1;
+  return source->backing_read < source->backing_rows;
+}
+
 /* Moves the CNT rows in DS starting at position OLD_START so
    that they then start at position NEW_START.  Equivalent to
    deleting the given rows, then inserting them at what becomes
@@ -699,6 +742,8 @@ datasheet_make_reader (struct datasheet *ds)
 {
   struct casereader *reader;
   ds = datasheet_rename (ds);
+  if (needs_compaction (ds))
+    compact_datasheet (ds);
   reader = casereader_create_random (datasheet_get_proto (ds),
                                      datasheet_get_n_rows (ds),
                                      &datasheet_reader_class, ds);
@@ -851,6 +896,151 @@ rw_case (struct datasheet *ds, enum rw_op op,
   return true;
 }
 
+/* Returns the number of separate runs of columns in DS that
+   rw_case() must read or write separately to access a whole row. */
+static size_t
+count_column_runs (const struct datasheet *ds)
+{
+  const struct source *prev = NULL;
+  size_t n_runs = 0;
+  size_t i;
+
+  for (i = 0; i < ds->n_columns; i++)
+    {
+      const struct column *column = &ds->columns[i];
+      if (column->width >= 0 && column->source != prev)
+        n_runs++;
+      prev = column->width >= 0 ? column->source : NULL;
+    }
+  return n_runs;
+}
+
+/* How fragmented a datasheet must become before
+   datasheet_make_reader() compacts it.  Only tests change this, to
+   exercise compact_datasheet() on the small datasheets that they can
+   check exhaustively. */
+static int compaction_threshold = 8;
+
+/* Sets the fragmentation threshold for compacting datasheets to
+   THRESHOLD.  A threshold of 0 compacts every datasheet that has at
+   least one row and one column.  For testing purposes only. */
+void
+datasheet_set_compaction_threshold (int threshold)
+{
+  compaction_threshold = threshold;
+}
+
+/* Returns true if editing has fragmented DS enough that reading all
+   of its rows would be faster after compact_datasheet().
+
+   A datasheet that has not been edited is never fragmented: all of
+   its columns come from a single source, and its rows map to
+   consecutive physical rows. */
+static bool
+needs_compaction (const struct datasheet *ds)
+{
+  casenumber n_rows = datasheet_get_n_rows (ds);
+
+  return (n_rows > 0
+          && (count_column_runs (ds) > compaction_threshold
+              || (axis_count_groups (ds->rows)
+                  > 2 * compaction_threshold + n_rows / 16)));
+}
+
+/* Rebuilds DS so that its columns are stored contiguously, in
+   logical order, in a single new source, and so that its logical
+   rows map to consecutive physical rows.  This costs one pass over
+   the data, but afterward each row may be read or written in a
+   single operation, instead of one per run of columns and with a
+   lookup in a fragmented row mapping.
+
+   Returns true if successful, false on I/O error.  On failure, DS is
+   tainted but its data is otherwise unchanged. */
+static bool
+compact_datasheet (struct datasheet *ds)
+{
+  casenumber n_rows = datasheet_get_n_rows (ds);
+  size_t n_bytes = caseproto_to_n_bytes (datasheet_get_proto (ds));
+  struct column *columns;
+  struct source *source;
+  size_t byte_ofs;
+  uint8_t *row_data;
+  casenumber row;
+  size_t i;
+
+  if (n_bytes == 0)
+    return true;
+
+  source = source_create_empty (n_bytes);
+  range_set_set0 (source->avail, 0, n_bytes);
+
+  columns = xnmalloc (ds->n_columns, sizeof *columns);
+  byte_ofs = 0;
+  for (i = 0; i < ds->n_columns; i++)
+    {
+      struct column *column = &columns[i];
+
+      column->width = ds->columns[i].width;
+      column->value_ofs = -1;
+      if (column->width >= 0)
+        {
+          column->source = source;
+          column->byte_ofs = byte_ofs;
+          byte_ofs += width_to_n_bytes (column->width);
+        }
+      else
+        {
+          column->source = NULL;
+          column->byte_ofs = -1;
+        }
+    }
+
+  row_data = xmalloc (n_bytes);
+  for (row = 0; row < n_rows; row++)
+    {
+      struct ccase *c = datasheet_get_row (ds, row);
+
+      if (c == NULL)
+        break;
+      for (i = 0; i < ds->n_columns; i++)
+        if (columns[i].width >= 0)
+          memcpy (row_data + columns[i].byte_ofs,
+                  value_to_data (case_data_idx (c, i), columns[i].width),
+                  width_to_n_bytes (columns[i].width));
+      case_unref (c);
+
+      if (!sparse_xarray_write (source->data, row, 0, n_bytes, row_data))
+        {
+          taint_set_taint (ds->taint);
+          break;
+        }
+    }
+  free (row_data);
+
+  if (row < n_rows)
+    {
+      source_destroy (source);
+      free (columns);
+      return false;
+    }
+
+  for (i = 0; i < ds->n_sources; i++)
+    source_destroy (ds->sources[i]);
+  ds->sources = xrealloc (ds->sources, sizeof *ds->sources);
+  ds->sources[0] = source;
+  ds->n_sources = 1;
+
+  free (ds->columns);
+  ds->columns = columns;
+
+  axis_destroy (ds->rows);
+  ds->rows = axis_create ();
+  if (n_rows > 0)
+    axis_insert (ds->rows, 0, axis_extend (ds->rows, n_rows), n_rows);
+
+  return true;
+}
+
 /* An axis.
 
    An axis has two functions.  First, it maintains a mapping from
@@ -1028,6 +1218,16 @@ axis_get_size (const struct axis *axis)
   return tower_height (&axis->log_to_phy);
 }
 
+/* Returns the number of runs of consecutive logical ordinates in
+   AXIS that map to consecutive physical ordinates.  This is 1 for an
+   axis that has only been extended, and it grows as ordinates are
+   inserted, removed, and moved. */
+static size_t
+axis_count_groups (const struct axis *axis)
+{
+  return tower_count (&axis->log_to_phy);
+}
+
 /* Inserts the CNT contiguous physical ordinates starting at
    PHY_START into AXIS's logical-to-physical mapping, starting at
    logical position LOG_START. */
@@ -1247,6 +1447,7 @@ source_create_empty (size_t n_bytes)
   source->data = sparse_xarray_create (n_bytes, MAX (max_memory_rows, 4));
   source->backing = NULL;
   source->backing_rows = 0;
+  source->backing_read = 0;
   source->n_used = 0;
   return source;
 }
@@ -1288,6 +1489,7 @@ source_clone (const struct source *old)
   new->data = sparse_xarray_clone (old->data);
   new->backing = old->backing != NULL ? casereader_clone (old->backing) : NULL;
   new->backing_rows = old->backing_rows;
+  new->backing_read = old->backing_read;
   new->n_used = old->n_used;
   if (new->data == NULL)
     {
@@ -1351,6 +1553,29 @@ source_get_backing_n_rows (const struct source *source)
   return source->backing_rows;
 }
 
+/* Stores into *START and *END the first byte offset and one past the
+   last byte offset, within their source, of the N COLUMNS, and into
+   *N_BYTES the number of bytes that they occupy. */
+static void
+get_column_span (const struct column columns[], size_t n,
+                 size_t *start, size_t *end, size_t *n_bytes)
+{
+  size_t i;
+
+  *start = SIZE_MAX;
+  *end = 0;
+  *n_bytes = 0;
+  for (i = 0; i < n; i++)
+    {
+      size_t ofs = columns[i].byte_ofs;
+      size_t width = width_to_n_bytes (columns[i].width);
+
+      *start = MIN (*start, ofs);
+      *end = MAX (*end, ofs + width);
+      *n_bytes += width;
+    }
+}
+
 /* Reads the N COLUMNS in the given ROW, into the N VALUES.  Returns true if
    successful, false on I/O error.
 
@@ -1367,12 +1592,33 @@ source_read (const struct column columns[], casenumber row,
   if (source->backing == NULL
       || sparse_xarray_contains_row (source->data, row))
     {
+      size_t start, end, n_bytes;
       bool ok = true;
 
-      for (i = 0; i < n && ok; i++)
-        ok = sparse_xarray_read (source->data, row, columns[i].byte_ofs,
-                                 width_to_n_bytes (columns[i].width),
-                                 value_to_data (&values[i], columns[i].width));
+      get_column_span (columns, n, &start, &end, &n_bytes);
+      if (n > 1 && end - start <= 2 * n_bytes)
+        {
+          /* The columns are packed closely together, so read them all
+             with a single call. */
+          uint8_t stack_buf[1024];
+          uint8_t *buf = (end - start <= sizeof stack_buf
+                          ? stack_buf : xmalloc (end - start));
+
+          ok = sparse_xarray_read (source->data, row, start, end - start, buf);
+          if (ok)
+            for (i = 0; i < n; i++)
+              memcpy (value_to_data (&values[i], columns[i].width),
+                      buf + (columns[i].byte_ofs - start),
+                      width_to_n_bytes (columns[i].width));
+          if (buf != stack_buf)
+            free (buf);
+        }
+      else
+        for (i = 0; i < n && ok; i++)
+          ok = sparse_xarray_read (source->data, row, columns[i].byte_ofs,
+                                   width_to_n_bytes (columns[i].width),
+                                   value_to_data (&values[i],
+                                                  columns[i].width));
       return ok;
     }
   else
@@ -1446,6 +1692,31 @@ source_write (const struct column columns[], casenumber row,
         return false;
     }
 
+  if (n > 1)
+    {
+      size_t start, end, n_bytes;
+
+      get_column_span (columns, n, &start, &end, &n_bytes);
+      if (end - start == n_bytes)
+        {
+          /* The columns exactly fill a contiguous range of bytes, so
+             write them all with a single call. */
+          uint8_t stack_buf[1024];
+          uint8_t *buf = (n_bytes <= sizeof stack_buf
+                          ? stack_buf : xmalloc (n_bytes));
+          bool ok;
+
+          for (i = 0; i < n; i++)
+            memcpy (buf + (columns[i].byte_ofs - start),
+                    value_to_data (&values[i], columns[i].width),
+                    width_to_n_bytes (columns[i].width));
+          ok = sparse_xarray_write (source->data, row, start, n_bytes, buf);
+          if (buf != stack_buf)
+            free (buf);
+          return ok;
+        }
+    }
+
   for (i = 0; i < n; i++)
     if (!sparse_xarray_write (source->data, row, columns[i].byte_ofs,
                               width_to_n_bytes (columns[i].width),
@@ -1550,6 +1821,14 @@ hash_datasheet (const struct datasheet *ds)
     }
   axis_hash (ds->rows, &ctx);
   md4_process_bytes (&ds->column_min_alloc, sizeof ds->column_min_alloc, &ctx);
+  if (ds->n_sources > 0 && source_has_backing (ds->sources[0]))
+    {
+      /* Distinguishes datasheets that differ only in how far
+         datasheet_read_ahead() has read. */
+      const struct source *source = ds->sources[0];
+      md4_process_bytes (&source->backing_read, sizeof source->backing_read,
+                         &ctx);
+    }
   md4_finish_ctx (&ctx, hash);
   return hash[0];
 }
@@ -64,6 +64,7 @@ void datasheet_delete_rows (struct datasheet *,
 void datasheet_move_rows (struct datasheet *,
                           size_t old_start, size_t new_start,
                           size_t cnt);
+bool datasheet_read_ahead (struct datasheet *, casenumber n_rows);
 
 /* Data. */
 struct ccase *datasheet_get_row (const struct datasheet *, casenumber);
@@ -77,4 +78,7 @@ bool datasheet_put_value (struct datasheet *, casenumber, size_t column,
 unsigned int hash_datasheet (const struct datasheet *ds);
 struct datasheet *clone_datasheet (const struct datasheet *ds);
 
+/* For testing purposes only. */
+void datasheet_set_compaction_threshold (int threshold);
+
 #endif /* data/datasheet.h */
@@ -547,16 +547,24 @@ static void
 reindex_var (struct dictionary *d, struct vardict_info *vardict)
 {
   struct variable *var = vardict->var;
-  struct variable *old = var_clone (var);
 
-  var_set_vardict (var, vardict);
-  hmap_insert_fast (&d->name_map, &vardict->name_node,
-                    vardict->name_node.hash);
-
-  if ( d->changed ) d->changed (d, d->changed_data);
-  if ( d->callbacks &&  d->callbacks->var_changed )
-    d->callbacks->var_changed (d, var_get_dict_index (var), VAR_TRAIT_POSITION, old, d->cb_data);
-  var_destroy (old);
+  if (d->callbacks && d->callbacks->var_changed)
+    {
+      struct variable *old = var_clone (var);
+
+      var_set_vardict (var, vardict);
+      hmap_insert_fast (&d->name_map, &vardict->name_node,
+                        vardict->name_node.hash);
+      d->callbacks->var_changed (d, var_get_dict_index (var),
+                                 VAR_TRAIT_POSITION, old, d->cb_data);
+      var_destroy (old);
+    }
+  else
+    {
+      var_set_vardict (var, vardict);
+      hmap_insert_fast (&d->name_map, &vardict->name_node,
+                        vardict->name_node.hash);
+    }
 }
 
 /* Sets the case_index in V's vardict to CASE_INDEX. */
@@ -578,7 +586,8 @@ unindex_vars (struct dictionary *d, size_t from, size_t to)
 }
 
 /* Re-sets the dict_index in the dictionary variables with
-   indexes from FROM to TO (exclusive). */
+   indexes from FROM to TO (exclusive).  Invokes D's generic change
+   callback once for the whole range, not once per variable. */
 static void
 reindex_vars (struct dictionary *d, size_t from, size_t to)
 {
@@ -586,6 +595,9 @@ reindex_vars (struct dictionary *d, size_t from, size_t to)
 
   for (i = from; i < to; i++)
     reindex_var (d, &d->var[i]);
+
+  if (from < to && d->changed)
+    d->changed (d, d->changed_data);
 }
 
 /* Deletes variable V from dictionary D and frees V.
@@ -640,18 +652,154 @@ dict_delete_var (struct dictionary *d, struct variable *v)
   var_destroy (v);
 }
 
+/* Deletes from D each variable whose dict_index I has DOOMED[I] set
+   to true, and frees those variables.  Runs in time linear in the
+   number of variables in D, regardless of how many are deleted.
+
+   D's generic change callback is invoked once.  The var_deleted
+   callback is invoked once per deleted variable, in
+   decreasing order of the variables' former dict_index, so that a
+   client that mirrors D's variables in an array can delete each of
+   them in turn without its other indexes becoming stale.  Before each
+   callback, the variables that have not yet been reported remain in
+   D, after the surviving variables, so that D's variable count always
+   agrees with the number of deletions reported so far. */
+static void
+delete_vars__ (struct dictionary *d, const bool *doomed)
+{
+  struct deleted_var
+    {
+      struct vardict_info vardict;
+      int dict_index;
+    };
+  struct deleted_var *deleted;
+  size_t n_deleted, n_kept;
+  size_t first, i, j;
+
+  for (first = 0; first < d->var_cnt; first++)
+    if (doomed[first])
+      break;
+  if (first >= d->var_cnt)
+    return;
+
+  /* Remove the doomed variables from the split variables, multiple
+     response sets, weight, and filter, each in a single pass. */
+  for (i = j = 0; i < d->split_cnt; i++)
+    if (!doomed[var_get_dict_index (d->split[i])])
+      d->split[j++] = d->split[i];
+  if (j != d->split_cnt)
+    {
+      d->split_cnt = j;
+      if (d->changed) d->changed (d, d->changed_data);
+      if (d->callbacks &&  d->callbacks->split_changed)
+        d->callbacks->split_changed (d, d->cb_data);
+    }
+
+  for (i = 0; i < d->n_mrsets; )
+    {
+      struct mrset *mrset = d->mrsets[i];
+
+      for (j = 0; j < mrset->n_vars; )
+        if (doomed[var_get_dict_index (mrset->vars[j])])
+          remove_element (mrset->vars, mrset->n_vars--,
+                          sizeof *mrset->vars, j);
+        else
+          j++;
+
+      if (mrset->n_vars < 2)
+        {
+          mrset_destroy (mrset);
+          d->mrsets[i] = d->mrsets[--d->n_mrsets];
+        }
+      else
+        i++;
+    }
+
+  if (d->weight != NULL && doomed[var_get_dict_index (d->weight)])
+    dict_set_weight (d, NULL);
+
+  if (d->filter != NULL && doomed[var_get_dict_index (d->filter)])
+    dict_set_filter (d, NULL);
+
+  dict_clear_vectors (d);
+
+  /* Compact the var array, moving the doomed variables after the
+     surviving ones, in their original order, and remembering each
+     doomed variable's former dict_index for the callbacks. */
+  unindex_vars (d, first, d->var_cnt);
+  deleted = xnmalloc (d->var_cnt - first, sizeof *deleted);
+  n_deleted = 0;
+  for (i = j = first; i < d->var_cnt; i++)
+    if (doomed[i])
+      {
+        struct deleted_var *dv = &deleted[n_deleted++];
+        dv->vardict = d->var[i];
+        dv->dict_index = i;
+      }
+    else
+      d->var[j++] = d->var[i];
+  n_kept = j;
+  for (i = 0; i < n_deleted; i++)
+    d->var[n_kept + i] = deleted[i].vardict;
+
+  /* Update dict_index for each affected variable. */
+  reindex_vars (d, first, d->var_cnt);
+
+  if ( d->changed ) d->changed (d, d->changed_data);
+
+  /* Remove the doomed variables from the end of the var array one at a
+     time, highest former dict_index first. */
+  for (i = n_deleted; i-- > 0; )
+    {
+      struct vardict_info *vardict = &d->var[n_kept + i];
+      struct variable *v = vardict->var;
+      int case_index = vardict->case_index;
+
+      unindex_var (d, vardict);
+      var_clear_vardict (v);
+      d->var_cnt--;
+
+      invalidate_proto (d);
+      if (d->callbacks &&  d->callbacks->var_deleted )
+        d->callbacks->var_deleted (d, v, deleted[i].dict_index,
+                                   case_index, d->cb_data);
+      var_destroy (v);
+    }
+  free (deleted);
+}
+
 /* Deletes the COUNT variables listed in VARS from D.  This is
-   unsafe; see the comment on dict_delete_var() for details. */
+   unsafe; see the comment on dict_delete_var() for details.  Runs
+   in time linear in the number of variables in D. */
 void
 dict_delete_vars (struct dictionary *d,
                   struct variable *const *vars, size_t count)
 {
-  /* FIXME: this can be done in O(count) time, but this algorithm
-     is O(count**2). */
+  bool *doomed;
+  size_t i;
+
   assert (count == 0 || vars != NULL);
 
-  while (count-- > 0)
-    dict_delete_var (d, *vars++);
+  if (count == 0)
+    return;
+  else if (count == 1)
+    {
+      dict_delete_var (d, vars[0]);
+      return;
+    }
+
+  doomed = xcalloc (d->var_cnt, sizeof *doomed);
+  for (i = 0; i < count; i++)
+    {
+      size_t dict_index;
+
+      assert (dict_contains_var (d, vars[i]));
+      dict_index = var_get_dict_index (vars[i]);
+      assert (!doomed[dict_index]);
+      doomed[dict_index] = true;
+    }
+  delete_vars__ (d, doomed);
+  free (doomed);
 }
 
 /* Deletes the COUNT variables in D starting at index IDX.  This
@@ -660,27 +808,33 @@ dict_delete_vars (struct dictionary *d,
 void
 dict_delete_consecutive_vars (struct dictionary *d, size_t idx, size_t count)
 {
-  /* FIXME: this can be done in O(count) time, but this algorithm
-     is O(count**2). */
+  bool *doomed;
+  size_t i;
+
   assert (idx + count <= d->var_cnt);
 
-  while (count-- > 0)
-    dict_delete_var (d, d->var[idx].var);
+  if (count == 0)
+    return;
+
+  doomed = xcalloc (d->var_cnt, sizeof *doomed);
+  for (i = idx; i < idx + count; i++)
+    doomed[i] = true;
+  delete_vars__ (d, doomed);
+  free (doomed);
 }
 
 /* Deletes scratch variables from dictionary D. */
 void
 dict_delete_scratch_vars (struct dictionary *d)
 {
-  int i;
+  bool *doomed;
+  size_t i;
 
-  /* FIXME: this can be done in O(count) time, but this algorithm
-     is O(count**2). */
-  for (i = 0; i < d->var_cnt; )
-    if (var_get_dict_class (d->var[i].var) == DC_SCRATCH)
-      dict_delete_var (d, d->var[i].var);
-    else
-      i++;
+  doomed = xcalloc (d->var_cnt, sizeof *doomed);
+  for (i = 0; i < d->var_cnt; i++)
+    doomed[i] = var_get_dict_class (d->var[i].var) == DC_SCRATCH;
+  delete_vars__ (d, doomed);
+  free (doomed);
 }
 
 /* Moves V to 0-based position IDX in D.  Other variables in D,
@@ -842,6 +996,9 @@ dict_rename_vars (struct dictionary *d,
     for (i = 0; i < count; i++)
       var_clear_short_names (vars[i]);
 
+  if (count > 0 && d->changed)
+    d->changed (d, d->changed_data);
+
   pool_destroy (pool);
   return true;
 }
@@ -206,6 +206,7 @@ gnumeric_get_sheet_name (struct spreadsheet *s, int n)
 
 
 static void process_node (struct gnumeric_reader *r, struct state_data *sd);
+static bool ensure_meta_reader (struct gnumeric_reader *r);
 
 
 
@@ -217,6 +218,9 @@ gnumeric_get_sheet_range (struct spreadsheet *s, int n)
   
   assert (n < s->n_sheets);
 
+  if (gr->sheets[n].stop_col == -1 && !ensure_meta_reader (gr))
+    return NULL;
+
   while ( 
 	 (gr->sheets[n].stop_col == -1)
 	 && 
@@ -517,29 +521,21 @@ gnumeric_error_handler (void *ctx, const char *mesg,
        mesg);
 }
 
-static struct gnumeric_reader *
-gnumeric_reopen (struct gnumeric_reader *r, const char *filename, bool show_errors)
-{  
+/* Opens R's file afresh as a libxml stream in SD and advances it past the
+   sheet name index to the start of the workbook.  Returns true if
+   successful, false if the file cannot be opened or does not appear to be a
+   gnumeric spreadsheet. */
+static bool
+init_state_data (struct gnumeric_reader *r, struct state_data *sd,
+                 bool show_errors)
+{
   int ret = -1;
-  struct state_data *sd;
-
   xmlTextReaderPtr xtr;
   gzFile gz;
 
-  assert (r == NULL || filename == NULL);
-
-  if (filename)
-    {
-      gz = gzopen (filename, "r");
-    }
-  else
-    {
-      gz = gzopen (r->spreadsheet.file_name, "r");
-    }
-
+  gz = gzopen (r->spreadsheet.file_name, "r");
   if (NULL == gz)
-    return NULL;
-
+    return false;
 
   xtr = xmlReaderForIO ((xmlInputReadCallback) gzread,
 			(xmlInputCloseCallback) gzclose, gz,
@@ -549,31 +545,16 @@ gnumeric_reopen (struct gnumeric_reader *r, const char *filename, bool show_erro
   if (xtr == NULL)
     {
       gzclose (gz);
-      return NULL;
+      return false;
     }
 
-  if (r == NULL)
-    {
-      r = xzalloc (sizeof *r);
-      r->spreadsheet.n_sheets = -1;
-      r->spreadsheet.file_name = filename;
-      sd = &r->msd;
-    }
-  else
-    {
-      sd = &r->rsd;
-    }
-  
   if (show_errors) 
     xmlTextReaderSetErrorHandler (xtr, gnumeric_error_handler, r);
 
-  r->target_sheet = NULL;
-  r->target_sheet_index = -1;
-
   sd->row = sd->col = -1;
+  sd->current_sheet = -1;
   sd->state = STATE_PRE_INIT;
   sd->xtr = xtr;
-  r->ref_cnt++;
 
   /* Advance to the start of the workbook.
      This gives us some confidence that we are actually dealing with a gnumeric
@@ -585,15 +566,77 @@ gnumeric_reopen (struct gnumeric_reader *r, const char *filename, bool show_erro
       process_node (r, sd);
     }
 
-
   if ( ret != 1)
     {
       /* Does not seem to be a gnumeric file */
       xmlFreeTextReader (sd->xtr);
-      free (r);
-      return NULL;
+      sd->xtr = NULL;
+      return false;
     }
 
+  return true;
+}
+
+/* Returns true if the meta-data stream of R has not yet been advanced beyond
+   the start of the workbook, so that it may be handed over to a casereader
+   instead of decompressing and parsing the file a second time. */
+static bool
+meta_reader_is_pristine (const struct gnumeric_reader *r)
+{
+  return (r->msd.xtr != NULL
+          && r->msd.state == STATE_INIT
+          && r->msd.current_sheet == -1);
+}
+
+/* Makes sure that R has a meta-data stream, reopening the file if the
+   original stream was handed over to a casereader. */
+static bool
+ensure_meta_reader (struct gnumeric_reader *r)
+{
+  return r->msd.xtr != NULL || init_state_data (r, &r->msd, false);
+}
+
+static struct gnumeric_reader *
+gnumeric_reopen (struct gnumeric_reader *r, const char *filename, bool show_errors)
+{  
+  struct state_data *sd;
+
+  assert (r == NULL || filename == NULL);
+
+  if (r == NULL)
+    {
+      r = xzalloc (sizeof *r);
+      r->spreadsheet.n_sheets = -1;
+      r->spreadsheet.file_name = filename;
+      sd = &r->msd;
+      if (!init_state_data (r, sd, show_errors))
+        {
+          free (r);
+          return NULL;
+        }
+    }
+  else if (meta_reader_is_pristine (r))
+    {
+      /* Nothing has been read from the meta-data stream beyond the sheet
+         name index, so take it over rather than reopening the file.  The
+         meta-data stream will be reopened later if it is needed again. */
+      sd = &r->rsd;
+      *sd = r->msd;
+      r->msd.xtr = NULL;
+      if (show_errors) 
+        xmlTextReaderSetErrorHandler (sd->xtr, gnumeric_error_handler, r);
+    }
+  else
+    {
+      sd = &r->rsd;
+      if (!init_state_data (r, sd, show_errors))
+        return NULL;
+    }
+
+  r->target_sheet = NULL;
+  r->target_sheet_index = -1;
+  r->ref_cnt++;
+
   r->spreadsheet.type = SPREADSHEET_GNUMERIC;
 
   if (show_errors)
@@ -639,9 +682,9 @@ gnumeric_make_reader (struct spreadsheet *spreadsheet,
   struct var_spec *var_spec = NULL;
   int n_var_specs = 0;
 
-  r = (struct gnumeric_reader *) (spreadsheet);
-
-  r = gnumeric_reopen (r, NULL, true);
+  r = gnumeric_reopen ((struct gnumeric_reader *) spreadsheet, NULL, true);
+  if (r == NULL)
+    return NULL;
 
   if ( opts->cell_range )
     {
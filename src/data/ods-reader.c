@@ -197,6 +197,7 @@ reading_target_sheet (const struct ods_reader *r, const struct state_data *msd)
 
 
 static void process_node (struct ods_reader *or, struct state_data *r);
+static bool ensure_meta_reader (struct ods_reader *);
 
 
 const char *
@@ -207,6 +208,9 @@ ods_get_sheet_name (struct spreadsheet *s, int n)
 
   assert (n < s->n_sheets);
 
+  if (r->n_allocated_sheets <= n && !ensure_meta_reader (r))
+    return NULL;
+
   while ( 
 	  (r->n_allocated_sheets <= n)
 	  || or->state != STATE_SPREADSHEET
@@ -230,6 +234,10 @@ ods_get_sheet_range (struct spreadsheet *s, int n)
   
   assert (n < s->n_sheets);
 
+  if ((r->n_allocated_sheets <= n || r->sheets[n].stop_row == -1)
+      && !ensure_meta_reader (r))
+    return NULL;
+
   while ( 
 	  (r->n_allocated_sheets <= n)
 	  || (r->sheets[n].stop_row == -1) 
@@ -603,7 +611,26 @@ init_reader (struct ods_reader *r, bool report_errors)
   return xtr;
 }
 
+/* Makes sure that R has a stream from which to read the sheet meta-data,
+   reopening content.xml if the original stream was handed over to a
+   casereader by ods_make_reader(). */
+static bool
+ensure_meta_reader (struct ods_reader *r)
+{
+  if (r->msd.xtr != NULL)
+    return true;
+
+  r->msd.xtr = init_reader (r, false);
+  if (r->msd.xtr == NULL)
+    return false;
 
+  r->msd.row = 0;
+  r->msd.col = 0;
+  r->msd.current_sheet = 0;
+  r->msd.current_sheet_name = NULL;
+  r->msd.state = STATE_INIT;
+  return true;
+}
 
 struct spreadsheet *
 ods_probe (const char *filename, bool report_errors)
@@ -681,14 +708,27 @@ ods_make_reader (struct spreadsheet *spreadsheet,
   ds_init_empty (&r->ods_errs);
   ++r->ref_cnt;
 
-  xtr = init_reader (r, true);
-  if ( xtr == NULL)
-    goto error;
+  if (r->msd.xtr != NULL && r->msd.state == STATE_INIT)
+    {
+      /* Nothing has yet been read from the meta-data stream, so take it over
+         instead of inflating and parsing content.xml a second time.  It will
+         be reopened if the meta-data is needed later. */
+      xtr = r->msd.xtr;
+      r->msd.xtr = NULL;
+      xmlTextReaderSetErrorHandler (xtr, ods_error_handler, r);
+    }
+  else
+    {
+      xtr = init_reader (r, true);
+      if ( xtr == NULL)
+        goto error;
+    }
 
   r->rsd.xtr = xtr;
   r->rsd.row = 0;
   r->rsd.col = 0;
   r->rsd.current_sheet = 0;
+  r->rsd.current_sheet_name = NULL;
   r->rsd.state = STATE_INIT;
 
   r->used_first_case = false;
@@ -18,10 +18,12 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -36,6 +38,7 @@
 #include "data/short-names.h"
 #include "data/value-labels.h"
 #include "data/variable.h"
+#include "libpspp/cast.h"
 #include "libpspp/compiler.h"
 #include "libpspp/i18n.h"
 #include "libpspp/message.h"
@@ -62,6 +65,11 @@ static const char portable_to_local[256] =
     "                                                                "
   };
 
+/* Size of the buffer that holds the current line of a portable file.
+   Lines are normally 80 characters long, but longer lines are read in
+   pieces of this size. */
+#define PFM_LINE_BUF 128
+
 /* Portable file reader. */
 struct pfm_reader
   {
@@ -75,7 +83,12 @@ struct pfm_reader
     struct file_handle *fh;     /* File handle. */
     struct fh_lock *lock;       /* Read lock for file. */
     FILE *file;			/* File stream. */
+    off_t file_ofs;             /* Offset in file of next byte to read. */
     int line_length;            /* Number of characters so far on this line. */
+    char line[PFM_LINE_BUF];    /* Translated characters following cc. */
+    int line_pos;               /* Index of next character in line[]. */
+    int line_cnt;               /* Number of characters in line[]. */
+    off_t line_ofs;             /* Offset in file of line[0]. */
     char cc;			/* Current character. */
     char *trans;                /* 256-byte character set translation table. */
     int var_cnt;                /* Number of variables. */
@@ -98,6 +111,14 @@ error (struct pfm_reader *r, const char *msg,...)
      PRINTF_FORMAT (2, 3)
      NO_RETURN;
 
+/* Returns the approximate offset in R's file of the current character, for
+   use in error messages. */
+static off_t
+pfm_tell (const struct pfm_reader *r)
+{
+  return r->line_ofs + r->line_pos;
+}
+
 /* Displays MSG as an error message and aborts reading the
    portable file via longjmp(). */
 static void
@@ -109,7 +130,7 @@ error (struct pfm_reader *r, const char *msg, ...)
 
   ds_init_empty (&text);
   ds_put_format (&text, _("portable file %s corrupt at offset 0x%llx: "),
-                 fh_get_file_name (r->fh), (long long int) ftello (r->file));
+                 fh_get_file_name (r->fh), (long long int) pfm_tell (r));
   va_start (args, msg);
   ds_put_vformat (&text, msg, args);
   va_end (args);
@@ -141,7 +162,7 @@ warning (struct pfm_reader *r, const char *msg, ...)
 
   ds_init_empty (&text);
   ds_put_format (&text, _("reading portable file %s at offset 0x%llx: "),
-                 fh_get_file_name (r->fh), (long long int) ftello (r->file));
+                 fh_get_file_name (r->fh), (long long int) pfm_tell (r));
   va_start (args, msg);
   ds_put_vformat (&text, msg, args);
   va_end (args);
@@ -197,39 +218,83 @@ por_file_casereader_destroy (struct casereader *reader, void *r_)
     casereader_force_error (reader);
 }
 
-/* Read a single character into cur_char.  */
+/* Reads the next piece of the current line of R's file into R->line[],
+   translating it through R->trans if it has been set up.
+
+   Carriage returns are ignored entirely.  New-lines are mostly ignored, but
+   if a new-line occurs before the line has reached 80 bytes in length, then
+   the "missing" bytes are treated as spaces. */
 static void
-advance (struct pfm_reader *r)
+read_line (struct pfm_reader *r)
 {
-  int c;
+  int n = 0;
 
-  /* Read the next character from the file.
-     Ignore carriage returns entirely.
-     Mostly ignore new-lines, but if a new-line occurs before the
-     line has reached 80 bytes in length, then treat the
-     "missing" bytes as spaces. */
-  for (;;)
+  r->line_ofs = r->file_ofs;
+  while (n < PFM_LINE_BUF)
     {
-      while ((c = getc (r->file)) == '\r')
-        continue;
-      if (c != '\n')
+      int c = getc (r->file);
+      if (c == EOF)
         break;
+      r->file_ofs++;
 
-      if (r->line_length < 80)
+      if (c == '\n')
         {
-          c = ' ';
-          ungetc ('\n', r->file);
-          break;
+          /* Padding always fits, because N <= R->line_length. */
+          if (r->line_length < 80)
+            {
+              memset (&r->line[n], ' ', 80 - r->line_length);
+              n += 80 - r->line_length;
+            }
+          r->line_length = 0;
+          if (n > 0)
+            break;
+        }
+      else if (c != '\r')
+        {
+          r->line[n++] = c;
+          r->line_length++;
         }
-      r->line_length = 0;
     }
-  if (c == EOF)
+  if (n == 0)
     error (r, _("unexpected end of file"));
 
   if (r->trans != NULL)
-    c = r->trans[c];
-  r->cc = c;
-  r->line_length++;
+    {
+      int i;
+
+      for (i = 0; i < n; i++)
+        r->line[i] = r->trans[(unsigned char) r->line[i]];
+    }
+
+  r->line_pos = 0;
+  r->line_cnt = n;
+}
+
+/* Read a single character into cur_char.  */
+static inline void
+advance (struct pfm_reader *r)
+{
+  if (r->line_pos >= r->line_cnt)
+    read_line (r);
+  r->cc = r->line[r->line_pos++];
+}
+
+/* Copies the current character and the N - 1 characters that follow it in
+   R into BUF, then advances past them. */
+static void
+read_chars (struct pfm_reader *r, char *buf, int n)
+{
+  while (n-- > 0)
+    {
+      int chunk = MIN (n, r->line_cnt - r->line_pos);
+
+      *buf++ = r->cc;
+      memcpy (buf, &r->line[r->line_pos], chunk);
+      buf += chunk;
+      n -= chunk;
+      r->line_pos += chunk;
+      advance (r);
+    }
 }
 
 /* Skip a single character if present, and return whether it was
@@ -271,7 +336,10 @@ pfm_open (struct file_handle *fh)
   r->fh = fh_ref (fh);
   r->lock = NULL;
   r->file = NULL;
+  r->file_ofs = 0;
   r->line_length = 0;
+  r->line_pos = r->line_cnt = 0;
+  r->line_ofs = 0;
   r->weight_index = -1;
   r->trans = NULL;
   r->var_cnt = 0;
@@ -341,16 +409,30 @@ pfm_decode (struct any_reader *r_, const char *encoding UNUSED,
                                        &por_file_casereader_class, r);
 }
 
+/* base_30_table[C] is 1 plus the value of base-30 digit C, or 0 if C is not
+   a base-30 digit. */
+static const unsigned char base_30_table[UCHAR_MAX + 1] =
+  {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15,
+    ['F'] = 16, ['G'] = 17, ['H'] = 18, ['I'] = 19, ['J'] = 20,
+    ['K'] = 21, ['L'] = 22, ['M'] = 23, ['N'] = 24, ['O'] = 25,
+    ['P'] = 26, ['Q'] = 27, ['R'] = 28, ['S'] = 29, ['T'] = 30,
+  };
+
 /* Returns the value of base-30 digit C,
    or -1 if C is not a base-30 digit. */
-static int
+static inline int
 base_30_value (unsigned char c)
 {
-  static const char base_30_digits[] = "0123456789ABCDEFGHIJKLMNOPQRST";
-  const char *p = strchr (base_30_digits, c);
-  return p != NULL ? p - base_30_digits : -1;
+  return base_30_table[c] - 1;
 }
 
+/* Largest value that may be multiplied by 30 and have a base-30 digit added
+   while remaining exactly representable in a double. */
+#define MAX_EXACT_BASE_30 ((UINT64_C (1) << 53) / 30 - 1)
+
 /* Read a floating point value and return its value. */
 static double
 read_float (struct pfm_reader *r)
@@ -373,6 +455,30 @@ read_float (struct pfm_reader *r)
     }
 
   negative = match (r, '-');
+
+  /* Accumulate the leading digits in an integer, which is faster than
+     floating-point arithmetic.  This yields exactly the same result, because
+     every integer in this range is exactly representable as a double. */
+  {
+    uint64_t inum = 0;
+    int digit;
+
+    while ((digit = base_30_value (r->cc)) != -1 && inum <= MAX_EXACT_BASE_30)
+      {
+        got_digit = true;
+        inum = inum * 30 + digit;
+        advance (r);
+      }
+    num = inum;
+
+    /* A plain integer, which is by far the most common case. */
+    if (r->cc == '/' && got_digit)
+      {
+        advance (r);
+        return negative ? -num : num;
+      }
+  }
+
   for (;;)
     {
       int digit = base_30_value (r->cc);
@@ -474,12 +580,8 @@ read_string (struct pfm_reader *r, char *buf)
   if (n < 0 || n > 255)
     error (r, _("Bad string length %d."), n);
 
-  while (n-- > 0)
-    {
-      *buf++ = r->cc;
-      advance (r);
-    }
-  *buf = '\0';
+  read_chars (r, buf, n);
+  buf[n] = '\0';
 }
 
 
@@ -494,11 +596,7 @@ read_bytes (struct pfm_reader *r, uint8_t *buf)
   if (n < 0 || n > 255)
     error (r, _("Bad string length %d."), n);
 
-  while (n-- > 0)
-    {
-      *buf++ = r->cc;
-      advance (r);
-    }
+  read_chars (r, CHAR_CAST (char *, buf), n);
   return n;
 }
 
@@ -546,9 +644,11 @@ read_header (struct pfm_reader *r)
         trans[c] = portable_to_local[i];
     }
 
-  /* Set up the translation table, then read the first
-     translated character. */
+  /* Set up the translation table, translate the rest of the line that has
+     already been read, then read the first translated character. */
   r->trans = trans;
+  for (i = r->line_pos; i < r->line_cnt; i++)
+    r->line[i] = trans[(unsigned char) r->line[i]];
   advance (r);
 
   /* Skip and verify signature. */
@@ -28,6 +28,7 @@
 #include "data/any-reader.h"
 #include "data/attributes.h"
 #include "data/case.h"
+#include "data/casebatch.h"
 #include "data/casereader-provider.h"
 #include "data/casereader.h"
 #include "data/dictionary.h"
@@ -2698,6 +2699,61 @@ eof:
   return NULL;
 }
 
+/* Reads up to MAX_CASES cases from READER's file directly into
+   BATCH.  Returns the number of cases read, which is less than
+   MAX_CASES only at end of file or on error. */
+static size_t
+sys_file_casereader_read_batch (struct casereader *reader, void *r_,
+                                struct casebatch *batch, size_t max_cases)
+{
+  struct sfm_reader *r = r_;
+  size_t n;
+
+  if (r->error)
+    return 0;
+
+  for (n = 0; n < max_cases; n++)
+    {
+      size_t row = casebatch_add_row (batch);
+      int retval;
+      int i;
+
+      for (i = 0; i < r->sfm_var_cnt; i++)
+        {
+          struct sfm_var *sv = &r->sfm_vars[i];
+
+          if (sv->var_width == 0)
+            retval = read_case_number (
+              r, &casebatch_num_column_rw (batch, sv->case_index)[row]);
+          else
+            {
+              uint8_t *s = casebatch_str_rw (batch, sv->case_index, row);
+              retval = read_case_string (r, s + sv->offset,
+                                         sv->segment_width);
+              if (retval == 1)
+                {
+                  retval = skip_whole_strings (r,
+                                               ROUND_DOWN (sv->padding, 8));
+                  if (retval == 0)
+                    sys_error (r, r->pos,
+                               _("File ends in partial string value."));
+                }
+            }
+
+          if (retval != 1)
+            {
+              if (i != 0)
+                partial_record (r);
+              if (r->case_cnt != -1)
+                read_error (reader, r);
+              casebatch_truncate (batch, row);
+              return n;
+            }
+        }
+    }
+  return n;
+}
+
 /* Issues an error that R ends in a partial record. */
 static void
 partial_record (struct sfm_reader *r)
@@ -3754,6 +3810,7 @@ static const struct casereader_class sys_file_casereader_class =
     sys_file_casereader_destroy,
     NULL,
     NULL,
+    sys_file_casereader_read_batch,
   };
 
 const struct any_reader_class sys_file_reader_class =
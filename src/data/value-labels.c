@@ -42,6 +42,7 @@ val_labs_create (int width)
   struct val_labs *vls = xmalloc (sizeof *vls);
   vls->width = width;
   hmap_init (&vls->labels);
+  vls->ref_cnt = 1;
   return vls;
 }
 
@@ -57,11 +58,43 @@ val_labs_clone (const struct val_labs *vls)
     return NULL;
 
   copy = val_labs_create (vls->width);
+  hmap_reserve (&copy->labels, hmap_count (&vls->labels));
   HMAP_FOR_EACH (label, struct val_lab, node, &vls->labels)
-    val_labs_add (copy, &label->value, label->escaped_label);
+    {
+      /* The labels are interned, so they can be shared, and the values
+         are known to be distinct, so their hashes can be reused. */
+      struct val_lab *lab = xmalloc (sizeof *lab);
+      value_clone (&lab->value, &label->value, vls->width);
+      lab->label = intern_ref (label->label);
+      lab->escaped_label = intern_ref (label->escaped_label);
+      hmap_insert_fast (&copy->labels, &lab->node, label->node.hash);
+    }
   return copy;
 }
 
+/* Returns VLS with its reference count incremented, so that the
+   caller becomes another owner of VLS and must eventually pass it to
+   val_labs_destroy().  Returns a null pointer if VLS is null.
+
+   This is much cheaper than val_labs_clone(), but neither owner may
+   modify VLS afterward while it is shared. */
+struct val_labs *
+val_labs_ref (const struct val_labs *vls_)
+{
+  struct val_labs *vls = CONST_CAST (struct val_labs *, vls_);
+  if (vls != NULL)
+    vls->ref_cnt++;
+  return vls;
+}
+
+/* Returns true if VLS has more than one owner, in which case it must
+   not be modified. */
+bool
+val_labs_is_shared (const struct val_labs *vls)
+{
+  return vls->ref_cnt > 1;
+}
+
 /* Determines whether VLS's width can be changed to NEW_WIDTH,
    using the rules checked by value_is_resizable. */
 bool
@@ -82,6 +115,7 @@ void
 val_labs_set_width (struct val_labs *vls, int new_width)
 {
   assert (val_labs_can_set_width (vls, new_width));
+  assert (!val_labs_is_shared (vls));
   if (value_needs_resize (vls->width, new_width))
     {
       struct val_lab *label;
@@ -91,11 +125,12 @@ val_labs_set_width (struct val_labs *vls, int new_width)
   vls->width = new_width;
 }
 
-/* Destroys VLS. */
+/* Drops a reference to VLS, destroying it if that was the last
+   one. */
 void
 val_labs_destroy (struct val_labs *vls)
 {
-  if (vls != NULL)
+  if (vls != NULL && --vls->ref_cnt == 0)
     {
       val_labs_clear (vls);
       hmap_destroy (&vls->labels);
@@ -109,6 +144,7 @@ val_labs_clear (struct val_labs *vls)
 {
   struct val_lab *label, *next;
 
+  assert (!val_labs_is_shared (vls));
   HMAP_FOR_EACH_SAFE (label, next, struct val_lab, node, &vls->labels)
     {
       hmap_delete (&vls->labels, &label->node);
@@ -167,6 +203,7 @@ do_add_val_lab (struct val_labs *vls, const union value *value,
                 const char *escaped_label)
 {
   struct val_lab *lab = xmalloc (sizeof *lab);
+  assert (!val_labs_is_shared (vls));
   value_clone (&lab->value, value, vls->width);
   set_label (lab, escaped_label);
   hmap_insert (&vls->labels, &lab->node, value_hash (value, vls->width, 0));
@@ -199,6 +236,7 @@ val_labs_replace (struct val_labs *vls, const union value *value,
                   const char *label)
 {
   struct val_lab *vl = val_labs_lookup (vls, value);
+  assert (!val_labs_is_shared (vls));
   if (vl != NULL)
     {
       intern_unref (vl->label);
@@ -213,6 +251,7 @@ val_labs_replace (struct val_labs *vls, const union value *value,
 void
 val_labs_remove (struct val_labs *vls, struct val_lab *label)
 {
+  assert (!val_labs_is_shared (vls));
   hmap_delete (&vls->labels, &label->node);
   value_destroy (&label->value, vls->width);
   intern_unref (label->label);
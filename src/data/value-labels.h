@@ -75,16 +75,24 @@ val_lab_get_escaped_label (const struct val_lab *vl)
   return vl->escaped_label;
 }
 
-/* A set of value labels. */
+/* A set of value labels.
+
+   A set of value labels may be shared among several owners, e.g. a
+   variable and its clones, with val_labs_ref().  A shared set must
+   not be modified; use val_labs_clone() to obtain a private copy
+   first. */
 struct val_labs
   {
     int width;                  /* 0=numeric, otherwise string width. */
     struct hmap labels;         /* Hash table of `struct val_lab's. */
+    int ref_cnt;                /* Number of owners. */
   };
 
 /* Creating and destroying sets of value labels. */
 struct val_labs *val_labs_create (int width);
 struct val_labs *val_labs_clone (const struct val_labs *);
+struct val_labs *val_labs_ref (const struct val_labs *);
+bool val_labs_is_shared (const struct val_labs *);
 void val_labs_clear (struct val_labs *);
 void val_labs_destroy (struct val_labs *);
 size_t val_labs_count (const struct val_labs *);
@@ -82,6 +82,7 @@ static void var_set_print_format_quiet (struct variable *v, const struct fmt_spe
 static void var_set_write_format_quiet (struct variable *v, const struct fmt_spec *write);
 static void var_set_label_quiet (struct variable *v, const char *label);
 static void var_set_name_quiet (struct variable *v, const char *name);
+static void unshare_value_labels (struct variable *);
 
 /* Creates and returns a new variable with the given NAME and
    WIDTH and other fields initialized to default values.  The
@@ -270,7 +271,10 @@ var_set_width_and_formats (struct variable *v, int new_width,
   if (v->val_labs != NULL)
     {
       if (val_labs_can_set_width (v->val_labs, new_width))
-        val_labs_set_width (v->val_labs, new_width);
+        {
+          unshare_value_labels (v);
+          val_labs_set_width (v->val_labs, new_width);
+        }
       else
         {
           val_labs_destroy (v->val_labs);
@@ -418,6 +422,20 @@ var_is_str_missing (const struct variable *v, const uint8_t s[],
   return mv_is_str_missing (&v->miss, s, class);
 }
 
+/* V's value labels may be shared with clones of V (see var_clone()).
+   This gives V its own copy of its value labels, if they are shared,
+   so that they may be modified. */
+static void
+unshare_value_labels (struct variable *v)
+{
+  if (v->val_labs != NULL && val_labs_is_shared (v->val_labs))
+    {
+      struct val_labs *copy = val_labs_clone (v->val_labs);
+      val_labs_destroy (v->val_labs);
+      v->val_labs = copy;
+    }
+}
+
 /* Returns variable V's value labels,
    possibly a null pointer if it has none. */
 const struct val_labs *
@@ -472,6 +490,8 @@ alloc_value_labels (struct variable *v)
 {
   if (v->val_labs == NULL)
     v->val_labs = val_labs_create (v->width);
+  else
+    unshare_value_labels (v);
 }
 
 /* Attempts to add a value label with the given VALUE and UTF-8 encoded LABEL
@@ -1250,6 +1270,10 @@ var_has_attributes (const struct variable *v)
 
     - The new variable is not added to OLD_VAR's dictionary by
       default.  Use dict_clone_var, instead, to do that.
+
+   The new variable shares OLD_VAR's value labels until either one
+   modifies them, so cloning is cheap even for a variable with many
+   value labels.
 */
 struct variable *
 var_clone (const struct variable *old_var)
@@ -1260,7 +1284,7 @@ var_clone (const struct variable *old_var)
   var_set_missing_values_quiet (new_var, var_get_missing_values (old_var));
   var_set_print_format_quiet (new_var, var_get_print_format (old_var));
   var_set_write_format_quiet (new_var, var_get_write_format (old_var));
-  var_set_value_labels_quiet (new_var, var_get_value_labels (old_var));
+  new_var->val_labs = val_labs_ref (old_var->val_labs);
   var_set_label_quiet (new_var, var_get_label (old_var));
   var_set_measure_quiet (new_var, var_get_measure (old_var));
   var_set_role_quiet (new_var, var_get_role (old_var));
@@ -16,6 +16,7 @@
 
 #include <config.h>
 
+#include <math.h>
 #include <stdlib.h>
 
 #include "data/any-reader.h"
@@ -26,6 +27,7 @@
 #include "data/dataset.h"
 #include "data/dictionary.h"
 #include "data/format.h"
+#include "data/settings.h"
 #include "data/subcase.h"
 #include "data/variable.h"
 #include "language/command.h"
@@ -35,6 +37,8 @@
 #include "language/lexer/variable-parser.h"
 #include "language/stats/sort-criteria.h"
 #include "libpspp/assertion.h"
+#include "libpspp/hash-functions.h"
+#include "libpspp/hmap.h"
 #include "libpspp/i18n.h"
 #include "libpspp/message.h"
 #include "libpspp/string-array.h"
@@ -96,6 +100,11 @@ struct comb_proc
 
     struct case_matcher *matcher;
 
+    /* ALGORITHM=HASH: the TABLE files are looked up through in-memory
+       hash tables instead of merged, so that the FILE need not be
+       sorted. */
+    bool hash;
+
     /* FIRST, LAST.
        Only if "first" or "last" is nonnull are the remaining
        members used. */
@@ -115,6 +124,7 @@ static bool merge_dictionary (struct dictionary *const, struct comb_file *);
 
 static void execute_update (struct comb_proc *);
 static void execute_match_files (struct comb_proc *);
+static void execute_hash_match_files (struct comb_proc *);
 static void execute_add_files (struct comb_proc *);
 
 static bool create_flag_var (const char *subcommand_name, const char *var_name,
@@ -165,6 +175,7 @@ combine_files (enum comb_command_type command,
   proc.dict = dict_create (get_default_encoding ());
   proc.output = NULL;
   proc.matcher = NULL;
+  proc.hash = false;
   subcase_init_empty (&proc.by_vars);
   proc.first = NULL;
   proc.last = NULL;
@@ -349,6 +360,19 @@ combine_files (enum comb_command_type command,
           last_name = xstrdup (lex_tokcstr (lexer));
           lex_get (lexer);
         }
+      else if (command == COMB_MATCH && lex_match_id (lexer, "ALGORITHM"))
+        {
+	  lex_match (lexer, T_EQUALS);
+          if (lex_match_id (lexer, "HASH"))
+            proc.hash = true;
+          else if (lex_match_id (lexer, "MERGE"))
+            proc.hash = false;
+          else
+            {
+              lex_error_expecting (lexer, "HASH", "MERGE", NULL);
+              goto error;
+            }
+        }
       else if (lex_match_id (lexer, "MAP"))
 	{
 	  /* FIXME. */
@@ -393,6 +417,26 @@ combine_files (enum comb_command_type command,
           msg (SE, _("BY is required when %s is specified."), "SORT");
           goto error;
         }
+      if (proc.hash)
+        {
+          msg (SE, _("BY is required when %s is specified."),
+               "ALGORITHM=HASH");
+          goto error;
+        }
+    }
+  if (proc.hash)
+    {
+      if (proc.n_files - n_tables != 1)
+        {
+          msg (SE, _("ALGORITHM=HASH requires exactly one FILE "
+                     "subcommand."));
+          goto error;
+        }
+      if (first_name != NULL || last_name != NULL)
+        {
+          msg (SE, _("FIRST and LAST may not be used with ALGORITHM=HASH."));
+          goto error;
+        }
     }
 
   /* Add IN, FIRST, and LAST variables to master dictionary. */
@@ -451,17 +495,22 @@ combine_files (enum comb_command_type command,
           else
             file->reader = casereader_clone (active_file);
         }
-      if (!file->is_sorted)
+      if (!file->is_sorted && !proc.hash)
         file->reader = sort_execute (file->reader, &file->by_vars);
       taint_propagate (casereader_get_taint (file->reader), taint);
-      file->data = casereader_read (file->reader);
-      if (file->type == COMB_FILE)
-        case_matcher_add_input (proc.matcher, &file->by_vars,
-                                &file->data, &file->is_minimal);
+      if (!proc.hash)
+        {
+          file->data = casereader_read (file->reader);
+          if (file->type == COMB_FILE)
+            case_matcher_add_input (proc.matcher, &file->by_vars,
+                                    &file->data, &file->is_minimal);
+        }
     }
 
   if (command == COMB_ADD)
     execute_add_files (&proc);
+  else if (command == COMB_MATCH && proc.hash)
+    execute_hash_match_files (&proc);
   else if (command == COMB_MATCH)
     execute_match_files (&proc);
   else if (command == COMB_UPDATE)
@@ -674,6 +723,9 @@ free_comb_proc (struct comb_proc *proc)
 
 static bool scan_table (struct comb_file *, union value by[]);
 static struct ccase *create_output_case (const struct comb_proc *);
+static struct ccase *create_output_case__ (const struct comb_proc *,
+                                           const struct caseproto *);
+static void mark_file_used (const struct comb_file *, struct ccase *);
 static void apply_case (const struct comb_file *, struct ccase *);
 static void apply_nonmissing_case (const struct comb_file *, struct ccase *);
 static void advance_file (struct comb_file *, union value by[]);
@@ -739,6 +791,324 @@ execute_match_files (struct comb_proc *proc)
   output_buffered_case (proc);
 }
 
+/* ALGORITHM=HASH for MATCH FILES.
+
+   Instead of sorting every input and merging them, each TABLE is
+   loaded into a hash table keyed on its BY values and the FILE is read
+   once, in its original order, looking up each of its cases in the
+   hash tables.  The output is therefore in the FILE's order.
+
+   If the TABLEs do not all fit in the workspace at once, they are
+   divided into hash partitions that do, and the data passes through
+   as many passes as needed to apply all of the partitions.  Between
+   passes, the output cases are kept in a temporary file, along with
+   the BY values from the FILE (in case the BY variables were dropped
+   from the output), so that the FILE itself is only read once.
+
+   Within and across passes, TABLEs are applied in the opposite order
+   from their appearance on the command, so that when more than one
+   input has a given variable, the first one with a match wins, as
+   with the merge algorithm.  The FILE is always applied first, so its
+   variables are removed from the TABLEs that follow it. */
+
+/* A case in a TABLE, in a "struct comb_table_part"'s hash table. */
+struct comb_table_case
+  {
+    struct hmap_node node;      /* In struct comb_table_part's 'map'. */
+    struct ccase *c;
+  };
+
+/* One hash partition of a TABLE: the cases whose BY values hash to
+   'part' modulo 'n_parts'. */
+struct comb_table_part
+  {
+    struct comb_file *file;     /* The TABLE. */
+    unsigned int part;          /* This partition's number. */
+    unsigned int n_parts;       /* Number of partitions of the TABLE. */
+    size_t cost;                /* Estimated bytes needed to load it. */
+    struct hmap map;            /* Contains "struct comb_table_case"s. */
+  };
+
+/* Returns a hash value for the values in C of the fields in BY. */
+static unsigned int
+hash_by_values (const struct subcase *by, const struct ccase *c)
+{
+  unsigned int hash = 0;
+  size_t i;
+
+  for (i = 0; i < subcase_get_n_fields (by); i++)
+    hash = value_hash (case_data_idx (c, by->fields[i].case_index),
+                       by->fields[i].width, hash);
+  return hash;
+}
+
+/* Returns the partition, out of N_PARTS, for a case whose BY values
+   have the given HASH.  The hash is mixed again first, because a
+   partition's hash table buckets are chosen from the low bits of HASH. */
+static unsigned int
+partition_of_hash (unsigned int hash, unsigned int n_parts)
+{
+  return hash_int (hash, 0) % n_parts;
+}
+
+/* Reads the cases in PART's TABLE that belong to PART into its hash
+   table.  When the TABLE has more than one case with the same BY
+   values, only the first is kept, as with the merge algorithm. */
+static void
+load_table_part (struct comb_table_part *part)
+{
+  struct comb_file *file = part->file;
+  struct casereader *reader = casereader_clone (file->reader);
+  struct ccase *c;
+
+  hmap_init (&part->map);
+  for (; (c = casereader_read (reader)) != NULL; case_unref (c))
+    {
+      unsigned int hash = hash_by_values (&file->by_vars, c);
+      struct comb_table_case *tc;
+
+      if (partition_of_hash (hash, part->n_parts) != part->part)
+        continue;
+
+      HMAP_FOR_EACH_WITH_HASH (tc, struct comb_table_case, node, hash,
+                               &part->map)
+        if (subcase_equal (&file->by_vars, tc->c, &file->by_vars, c))
+          break;
+      if (tc == NULL)
+        {
+          tc = xmalloc (sizeof *tc);
+          tc->c = case_ref (c);
+          hmap_insert (&part->map, &tc->node, hash);
+        }
+    }
+  casereader_destroy (reader);
+}
+
+/* Frees the cases loaded into PART's hash table. */
+static void
+unload_table_part (struct comb_table_part *part)
+{
+  struct comb_table_case *tc, *next;
+
+  HMAP_FOR_EACH_SAFE (tc, next, struct comb_table_case, node, &part->map)
+    {
+      hmap_delete (&part->map, &tc->node);
+      case_unref (tc->c);
+      free (tc);
+    }
+  hmap_destroy (&part->map);
+}
+
+/* Looks up the BY values in C, whose fields are given by BY, in PART.
+   If PART has a case with those values, copies its data into C. */
+static void
+apply_table_part (const struct comb_table_part *part,
+                  const struct subcase *by, struct ccase *c)
+{
+  const struct comb_file *file = part->file;
+  unsigned int hash = hash_by_values (by, c);
+  const struct comb_table_case *tc;
+
+  if (partition_of_hash (hash, part->n_parts) != part->part)
+    return;
+
+  HMAP_FOR_EACH_WITH_HASH (tc, struct comb_table_case, node, hash, &part->map)
+    if (subcase_equal (by, c, &file->by_vars, tc->c))
+      {
+        subcase_copy (&file->src, tc->c, &file->dst, c);
+        mark_file_used (file, c);
+        return;
+      }
+}
+
+/* Removes from TABLE's data to copy to the output the variables that
+   the FILE MASTER also supplies. */
+static void
+drop_master_vars (struct comb_file *table, const struct comb_file *master)
+{
+  struct subcase src, dst;
+  size_t i;
+
+  subcase_init_empty (&src);
+  subcase_init_empty (&dst);
+  for (i = 0; i < subcase_get_n_fields (&table->dst); i++)
+    {
+      const struct subcase_field *s = &table->src.fields[i];
+      const struct subcase_field *d = &table->dst.fields[i];
+
+      if (!subcase_contains (&master->dst, d->case_index))
+        {
+          subcase_add_always (&src, s->case_index, s->width, SC_ASCEND);
+          subcase_add_always (&dst, d->case_index, d->width, SC_ASCEND);
+        }
+    }
+  subcase_destroy (&table->src);
+  subcase_destroy (&table->dst);
+  table->src = src;
+  table->dst = dst;
+}
+
+/* Divides the TABLEs in PROC into hash partitions that each fit in the
+   workspace.  Returns the partitions, in the order in which they should
+   be applied, and stores the number of them into *N_PARTSP. */
+static struct comb_table_part *
+plan_table_parts (struct comb_proc *proc, size_t *n_partsp)
+{
+  size_t workspace = settings_get_workspace ();
+  struct comb_table_part *parts = NULL;
+  size_t n_parts = 0;
+  size_t allocated_parts = 0;
+  size_t i;
+
+  for (i = proc->n_files; i-- > 0; )
+    {
+      struct comb_file *file = &proc->files[i];
+      const struct caseproto *proto;
+      double cost;
+      unsigned int n, j;
+
+      if (file->type != COMB_TABLE)
+        continue;
+
+      proto = casereader_get_proto (file->reader);
+      cost = ((double) casereader_count_cases (file->reader)
+              * (case_get_cost (proto) + sizeof (struct comb_table_case)));
+      n = cost > workspace ? ceil (cost / workspace) : 1;
+
+      for (j = 0; j < n; j++)
+        {
+          struct comb_table_part *part;
+
+          if (n_parts >= allocated_parts)
+            parts = x2nrealloc (parts, &allocated_parts, sizeof *parts);
+          part = &parts[n_parts++];
+          part->file = file;
+          part->part = j;
+          part->n_parts = n;
+          part->cost = cost / n;
+        }
+    }
+
+  *n_partsp = n_parts;
+  return parts;
+}
+
+/* Executes MATCH FILES with ALGORITHM=HASH. */
+static void
+execute_hash_match_files (struct comb_proc *proc)
+{
+  const struct caseproto *out_proto = dict_get_proto (proc->dict);
+  size_t n_out = caseproto_get_n_widths (out_proto);
+  size_t workspace = settings_get_workspace ();
+  struct comb_file *master = NULL;
+  struct comb_table_part *parts;
+  struct caseproto *work_proto;
+  struct casereader *input;
+  struct subcase work_by;
+  size_t n_parts;
+  size_t i;
+
+  for (i = 0; i < proc->n_files; i++)
+    {
+      struct comb_file *file = &proc->files[i];
+      if (file->type == COMB_FILE)
+        master = file;
+      else if (master != NULL)
+        drop_master_vars (file, master);
+    }
+  assert (master != NULL);
+
+  /* Between passes, each case carries the FILE's BY values after the
+     output variables. */
+  work_proto = caseproto_ref (out_proto);
+  subcase_init_empty (&work_by);
+  for (i = 0; i < subcase_get_n_fields (&master->by_vars); i++)
+    {
+      int width = master->by_vars.fields[i].width;
+
+      work_proto = caseproto_add_width (work_proto, width);
+      subcase_add_always (&work_by, n_out + i, width, SC_ASCEND);
+    }
+
+  parts = plan_table_parts (proc, &n_parts);
+
+  input = NULL;
+  i = 0;
+  do
+    {
+      struct casewriter *writer;
+      size_t first = i;
+      size_t cost = 0;
+      struct ccase *c;
+      size_t j;
+
+      /* Load as many partitions as fit in the workspace, but at least
+         one. */
+      do
+        {
+          if (i < n_parts)
+            {
+              load_table_part (&parts[i]);
+              cost += parts[i].cost;
+              i++;
+            }
+        }
+      while (i < n_parts && cost + parts[i].cost <= workspace);
+
+      writer = (i < n_parts
+                ? autopaging_writer_create (work_proto)
+                : proc->output);
+
+      if (input == NULL)
+        {
+          /* First pass: read the FILE. */
+          for (; (c = casereader_read (master->reader)) != NULL;
+               case_unref (c))
+            {
+              struct ccase *work = create_output_case__ (proc, work_proto);
+
+              subcase_copy (&master->by_vars, c, &work_by, work);
+              subcase_copy (&master->src, c, &master->dst, work);
+              mark_file_used (master, work);
+
+              for (j = first; j < i; j++)
+                apply_table_part (&parts[j], &work_by, work);
+
+              if (writer == proc->output)
+                work = case_resize (work, out_proto);
+              casewriter_write (writer, work);
+            }
+        }
+      else
+        {
+          /* Later passes: reread the output of the previous pass. */
+          while ((c = casereader_read (input)) != NULL)
+            {
+              c = case_unshare (c);
+              for (j = first; j < i; j++)
+                apply_table_part (&parts[j], &work_by, c);
+
+              if (writer == proc->output)
+                c = case_resize (c, out_proto);
+              casewriter_write (writer, c);
+            }
+          taint_propagate (casereader_get_taint (input),
+                           casewriter_get_taint (proc->output));
+          casereader_destroy (input);
+        }
+
+      for (j = first; j < i; j++)
+        unload_table_part (&parts[j]);
+
+      input = writer != proc->output ? casewriter_make_reader (writer) : NULL;
+    }
+  while (input != NULL);
+
+  free (parts);
+  subcase_destroy (&work_by);
+  caseproto_unref (work_proto);
+}
+
 /* Executes the UPDATE command. */
 static void
 execute_update (struct comb_proc *proc)
@@ -820,12 +1190,22 @@ scan_table (struct comb_file *file, union value by[])
    values of IN variables are set to 0. */
 static struct ccase *
 create_output_case (const struct comb_proc *proc)
+{
+  return create_output_case__ (proc, dict_get_proto (proc->dict));
+}
+
+/* Like create_output_case(), but creates the case with PROTO, which
+   must begin with the widths in the output dictionary's prototype.
+   Any values past those are left for the caller to initialize. */
+static struct ccase *
+create_output_case__ (const struct comb_proc *proc,
+                      const struct caseproto *proto)
 {
   size_t n_vars = dict_get_var_cnt (proc->dict);
   struct ccase *output;
   size_t i;
 
-  output = case_create (dict_get_proto (proc->dict));
+  output = case_create (proto);
   for (i = 0; i < n_vars; i++)
     {
       struct variable *v = dict_get_var (proc->dict, i);
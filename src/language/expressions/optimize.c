@@ -296,6 +296,7 @@ flatten_atom (union any_node *n, struct expression *e)
     case OP_vector:
     case OP_no_format:
     case OP_ni_format:
+    case OP_integer:
     case OP_pos_int:
       /* These are passed as aux data following the
          operation. */
@@ -337,6 +338,7 @@ flatten_composite (union any_node *n, struct expression *e)
           emit_format (e, &arg->format.f);
           break;
 
+        case OP_integer:
         case OP_pos_int:
           emit_integer (e, arg->integer.i);
           break;
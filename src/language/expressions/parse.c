@@ -1209,6 +1209,25 @@ no_match (const char *func_name,
   ds_destroy (&s);
 }
 
+/* Registers the variable that LAG function N lags for N_BEFORE cases
+   with E's dataset, and appends the index of its lagged values to N's
+   arguments, as the "lag_idx" auxiliary data that LAG takes, so that
+   evaluating N does not have to search for them. */
+static void
+add_lag_idx (struct expression *e, union any_node *n, int n_before)
+{
+  struct composite_node *c = &n->composite;
+  union any_node **args;
+  size_t lag_idx;
+
+  lag_idx = dataset_need_lag (e->ds, c->args[0]->variable.v, n_before);
+
+  args = pool_nalloc (e->expr_pool, c->arg_cnt + 1, sizeof *args);
+  memcpy (args, c->args, c->arg_cnt * sizeof *args);
+  args[c->arg_cnt++] = expr_allocate_integer (e, lag_idx);
+  c->args = args;
+}
+
 static union any_node *
 parse_function (struct lexer *lexer, struct expression *e)
 {
@@ -1307,14 +1326,14 @@ parse_function (struct lexer *lexer, struct expression *e)
   n->composite.min_valid = min_valid != -1 ? min_valid : f->array_min_elems;
 
   if (n->type == OP_LAG_Vn || n->type == OP_LAG_Vs)
-    dataset_need_lag (e->ds, 1);
+    add_lag_idx (e, n, 1);
   else if (n->type == OP_LAG_Vnn || n->type == OP_LAG_Vsn)
     {
       int n_before;
       assert (n->composite.arg_cnt == 2);
       assert (n->composite.args[1]->type == OP_pos_int);
       n_before = n->composite.args[1]->integer.i;
-      dataset_need_lag (e->ds, n_before);
+      add_lag_idx (e, n, n_before);
     }
 
   free (args);
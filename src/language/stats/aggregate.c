@@ -46,6 +46,7 @@
 #include "libpspp/str.h"
 #include "math/moments.h"
 #include "math/percentiles.h"
+#include "math/quantile-sketch.h"
 #include "math/sort.h"
 #include "math/statistic.h"
 
@@ -87,6 +88,13 @@ struct agr_var
     struct variable *subject;
     struct variable *weight;
     struct casewriter *writer;
+    struct quantile_sketch *sketch; /* MEDIAN with ALGORITHM=SKETCH. */
+
+    /* Values for MEDIAN, until there are too many to keep in memory,
+       after which they go to 'writer' instead. */
+    struct weighted_value *values;
+    size_t n_values;
+    size_t allocated_values;
   };
 
 
@@ -139,6 +147,9 @@ struct agr_proc
 
     bool add_variables;                 /* True iff the aggregated variables should
 					   be appended to the existing dictionary */
+    bool sketch;                        /* True to estimate MEDIAN with a
+                                           quantile sketch instead of
+                                           sorting. */
   };
 
 static void initialize_aggregate_info (struct agr_proc *);
@@ -233,6 +244,19 @@ cmd_aggregate (struct lexer *lexer, struct dataset *ds)
         copy_documents = true;
       else if (lex_match_id (lexer, "PRESORTED"))
         presorted = true;
+      else if (lex_match_id (lexer, "ALGORITHM"))
+        {
+	  lex_match (lexer, T_EQUALS);
+	  if (lex_match_id (lexer, "SKETCH"))
+	    agr.sketch = true;
+	  else if (lex_match_id (lexer, "EXACT"))
+	    agr.sketch = false;
+	  else
+	    {
+	      lex_error_expecting (lexer, "EXACT", "SKETCH", NULL);
+              goto error;
+	    }
+        }
       else if (lex_force_match_id (lexer, "BREAK"))
 	{
           int i;
@@ -727,6 +751,12 @@ agr_destroy (struct agr_proc *agr)
 	}
       else if (iter->function == SD)
         moments1_destroy (iter->moments);
+      else if (iter->function == MEDIAN)
+        {
+          quantile_sketch_destroy (iter->sketch);
+          casewriter_destroy (iter->writer);
+          free (iter->values);
+        }
 
       dict_destroy_internal_var (iter->subject);
       dict_destroy_internal_var (iter->weight);
@@ -739,6 +769,100 @@ agr_destroy (struct agr_proc *agr)
 
 /* Execution. */
 
+/* Writes VALUE, with the given WEIGHT, to the sort writer for MEDIAN
+   function ITER. */
+static void
+median_write (struct agr_var *iter, double value, double weight)
+{
+  struct ccase *cout = case_create (casewriter_get_proto (iter->writer));
+
+  case_data_rw (cout, iter->subject)->f = value;
+  case_data_rw (cout, iter->weight)->f = weight;
+  casewriter_write (iter->writer, cout);
+}
+
+/* Moves the values accumulated in memory for MEDIAN function ITER into
+   a new sort writer, for groups too large to keep in memory. */
+static void
+median_spill (struct agr_var *iter)
+{
+  struct caseproto *proto;
+  struct subcase ordering;
+  size_t i;
+
+  proto = caseproto_create ();
+  proto = caseproto_add_width (proto, 0);
+  proto = caseproto_add_width (proto, 0);
+
+  subcase_init_var (&ordering, iter->subject, SC_ASCEND);
+  iter->writer = sort_create_writer (&ordering, proto);
+  subcase_destroy (&ordering);
+  caseproto_unref (proto);
+
+  for (i = 0; i < iter->n_values; i++)
+    median_write (iter, iter->values[i].value, iter->values[i].weight);
+  iter->n_values = 0;
+}
+
+/* Adds VALUE, with the given WEIGHT, to MEDIAN function ITER.  Values
+   are kept in memory as long as they fit in the workspace. */
+static void
+median_add (struct agr_var *iter, double value, double weight)
+{
+  if (iter->writer == NULL)
+    {
+      if (iter->n_values >= iter->allocated_values)
+        {
+          size_t max_values = (settings_get_workspace ()
+                               / sizeof *iter->values);
+          if (iter->n_values < max_values)
+            iter->values = x2nrealloc (iter->values, &iter->allocated_values,
+                                       sizeof *iter->values);
+          else
+            median_spill (iter);
+        }
+
+      if (iter->writer == NULL)
+        {
+          struct weighted_value *wv = &iter->values[iter->n_values++];
+          wv->value = value;
+          wv->weight = weight;
+        }
+    }
+
+  if (iter->writer != NULL)
+    median_write (iter, value, weight);
+
+  iter->cc += weight;
+}
+
+/* Returns the median of the values added to MEDIAN function ITER, or
+   SYSMIS if they have no weight.  If they are all in memory, this
+   selects the median from them directly; otherwise, it reads them back
+   from the sort writer in sorted order. */
+static double
+median_calculate (struct agr_var *iter)
+{
+  struct percentile *median = percentile_create (0.5, iter->cc);
+  struct order_stats *os = &median->parent;
+  double result;
+
+  if (iter->writer != NULL)
+    {
+      struct casereader *sorted_reader = casewriter_make_reader (iter->writer);
+      iter->writer = NULL;
+
+      order_stats_accumulate (&os, 1, sorted_reader, iter->weight,
+                              iter->subject, iter->exclude);
+    }
+  else
+    order_stats_select (&os, 1, iter->values, iter->n_values);
+
+  result = iter->cc > 0 ? percentile_calculate (median, PC_HAVERAGE) : SYSMIS;
+  statistic_destroy (&median->parent.parent);
+  return result;
+}
+
 /* Accumulates aggregation data from the case INPUT. */
 static void
 accumulate_aggregate_info (struct agr_proc *agr, const struct ccase *input)
@@ -784,23 +908,10 @@ accumulate_aggregate_info (struct agr_proc *agr, const struct ccase *input)
             iter->dbl[1] += weight;
             break;
 	  case MEDIAN:
-	    {
-	      double wv ;
-	      struct ccase *cout;
-
-              cout = case_create (casewriter_get_proto (iter->writer));
-
-	      case_data_rw (cout, iter->subject)->f
-                = case_data (input, iter->src)->f;
-
-	      wv = dict_get_case_weight (agr->src_dict, input, NULL);
-
-	      case_data_rw (cout, iter->weight)->f = wv;
-
-	      iter->cc += wv;
-
-	      casewriter_write (iter->writer, cout);
-	    }
+	    if (iter->sketch != NULL)
+              quantile_sketch_add (iter->sketch, v->f, weight);
+            else
+              median_add (iter, v->f, weight);
 	    break;
 	  case SD:
             moments1_add (iter->moments, v->f, weight);
@@ -974,6 +1085,7 @@ dump_aggregate_info (const struct agr_proc *agr, struct casewriter *output, cons
 	  {
             value_set_missing (v, width);
 	    casewriter_destroy (i->writer);
+	    i->writer = NULL;
 	    continue;
 	  }
 
@@ -986,24 +1098,10 @@ dump_aggregate_info (const struct agr_proc *agr, struct casewriter *output, cons
 	    v->f = i->dbl[1] != 0.0 ? i->dbl[0] / i->dbl[1] : SYSMIS;
 	    break;
 	  case MEDIAN:
-	    {
-	      if ( i->writer)
-		{
-		  struct percentile *median = percentile_create (0.5, i->cc);
-		  struct order_stats *os = &median->parent;
-		  struct casereader *sorted_reader = casewriter_make_reader (i->writer);
-		  i->writer = NULL;
-
-		  order_stats_accumulate (&os, 1,
-					  sorted_reader,
-					  i->weight,
-					  i->subject,
-					  i->exclude);
-		  i->dbl[0] = percentile_calculate (median, PC_HAVERAGE);
-		  statistic_destroy (&median->parent.parent);
-		}
-	      v->f = i->dbl[0];
-	    }
+	    if (i->sketch != NULL)
+              v->f = quantile_sketch_quantile (i->sketch, 0.5);
+            else
+              v->f = median_calculate (i);
 	    break;
 	  case SD:
             {
@@ -1111,27 +1209,27 @@ initialize_aggregate_info (struct agr_proc *agr)
 	  memset (iter->string, 0, var_get_width (iter->src));
 	  break;
 	case MEDIAN:
-	  {
-            struct caseproto *proto;
-            struct subcase ordering;
-
-            proto = caseproto_create ();
-            proto = caseproto_add_width (proto, 0);
-            proto = caseproto_add_width (proto, 0);
-
-	    if ( ! iter->subject)
-	      iter->subject = dict_create_internal_var (0, 0);
-
-	    if ( ! iter->weight)
-	      iter->weight = dict_create_internal_var (1, 0);
+          if (agr->sketch)
+            {
+              if (iter->sketch == NULL)
+                iter->sketch = quantile_sketch_create (
+                  QUANTILE_SKETCH_DEFAULT_COMPRESSION);
+              else
+                quantile_sketch_clear (iter->sketch);
+            }
+          else
+	    {
+	      if ( ! iter->subject)
+		iter->subject = dict_create_internal_var (0, 0);
 
-            subcase_init_var (&ordering, iter->subject, SC_ASCEND);
-	    iter->writer = sort_create_writer (&ordering, proto);
-            subcase_destroy (&ordering);
-            caseproto_unref (proto);
+	      if ( ! iter->weight)
+		iter->weight = dict_create_internal_var (1, 0);
 
-	    iter->cc = 0;
-	  }
+              casewriter_destroy (iter->writer);
+              iter->writer = NULL;
+              iter->n_values = 0;
+	      iter->cc = 0;
+	    }
 	  break;
         case SD:
           if (iter->moments == NULL)
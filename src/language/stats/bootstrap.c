@@ -0,0 +1,300 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_sort.h>
+#include <gsl/gsl_statistics.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "data/case.h"
+#include "data/casegrouper.h"
+#include "data/casereader.h"
+#include "data/dataset.h"
+#include "data/dictionary.h"
+#include "data/missing-values.h"
+#include "data/variable.h"
+#include "language/command.h"
+#include "language/dictionary/split-file.h"
+#include "language/lexer/lexer.h"
+#include "language/lexer/variable-parser.h"
+#include "libpspp/message.h"
+#include "math/random.h"
+#include "math/resample.h"
+#include "output/tab.h"
+
+#include "gl/xalloc.h"
+
+#include "gettext.h"
+#define _(msgid) gettext (msgid)
+
+struct bootstrap
+  {
+    const struct variable **vars;
+    size_t n_vars;
+    const struct variable *wv;  /* Weight variable, or NULL. */
+
+    int n_samples;              /* Number of bootstrap replicates. */
+    double cilevel;             /* Confidence level, in percent. */
+    enum mv_class exclude;      /* Classes of missing values to exclude. */
+  };
+
+/* Computes the weighted mean of each of the columns in RS, using
+   WEIGHTS, into RESULTS. */
+static void
+mean_stat (const struct resample *rs, const double *weights,
+           double *results, void *bs_)
+{
+  const struct bootstrap *bs = bs_;
+  size_t n_rows = resample_get_n_rows (rs);
+  size_t i, j;
+
+  for (i = 0; i < bs->n_vars; i++)
+    {
+      const double *x = resample_get_column (rs, i);
+      double sum = 0.0;
+      double w = 0.0;
+
+      for (j = 0; j < n_rows; j++)
+        {
+          sum += weights[j] * x[j];
+          w += weights[j];
+        }
+      results[i] = w > 0.0 ? sum / w : SYSMIS;
+    }
+}
+
+static void
+bootstrap_output (const struct bootstrap *bs, const double *observed,
+                  double *replicates)
+{
+  const int heading_rows = 2;
+  const int n_cols = 6;
+  const int n_rows = heading_rows + bs->n_vars;
+  struct tab_table *t;
+  size_t i;
+
+  t = tab_create (n_cols, n_rows);
+  tab_title (t, _("Bootstrap Statistics"));
+  tab_headers (t, 1, 0, heading_rows, 0);
+  tab_box (t, TAL_2, TAL_2, -1, TAL_1, 0, 0, n_cols - 1, n_rows - 1);
+  tab_hline (t, TAL_2, 0, n_cols - 1, heading_rows);
+  tab_vline (t, TAL_2, 1, 0, n_rows - 1);
+
+  tab_joint_text (t, 2, 0, n_cols - 1, 0, TAB_CENTER | TAT_TITLE,
+                  _("Bootstrap"));
+  tab_hline (t, TAL_1, 2, n_cols - 1, 1);
+  tab_text (t, 1, 1, TAB_CENTER | TAT_TITLE, _("Mean"));
+  tab_text (t, 2, 1, TAB_CENTER | TAT_TITLE, _("Bias"));
+  tab_text (t, 3, 1, TAB_CENTER | TAT_TITLE, _("Std. Error"));
+  tab_text_format (t, 4, 1, TAB_CENTER | TAT_TITLE, _("%g%% Lower"),
+                   bs->cilevel);
+  tab_text_format (t, 5, 1, TAB_CENTER | TAT_TITLE, _("%g%% Upper"),
+                   bs->cilevel);
+
+  for (i = 0; i < bs->n_vars; i++)
+    {
+      const int row = heading_rows + i;
+      double *x = &replicates[i];
+      const size_t stride = bs->n_vars;
+      const size_t n = bs->n_samples;
+      double alpha = (1.0 - bs->cilevel / 100.0) / 2.0;
+
+      tab_text (t, 0, row, TAB_LEFT, var_to_string (bs->vars[i]));
+      tab_double (t, 1, row, 0, observed[i], NULL, RC_OTHER);
+      if (observed[i] == SYSMIS)
+        continue;
+
+      tab_double (t, 2, row, 0,
+                  gsl_stats_mean (x, stride, n) - observed[i], NULL, RC_OTHER);
+      tab_double (t, 3, row, 0,
+                  n > 1 ? gsl_stats_sd (x, stride, n) : SYSMIS,
+                  NULL, RC_OTHER);
+
+      gsl_sort (x, stride, n);
+      tab_double (t, 4, row, 0,
+                  gsl_stats_quantile_from_sorted_data (x, stride, n, alpha),
+                  NULL, RC_OTHER);
+      tab_double (t, 5, row, 0,
+                  gsl_stats_quantile_from_sorted_data (x, stride, n,
+                                                       1.0 - alpha),
+                  NULL, RC_OTHER);
+    }
+
+  tab_submit (t);
+}
+
+static void
+bootstrap_group (const struct bootstrap *bs, struct casereader *input,
+                 const struct dataset *ds, unsigned long int seed)
+{
+  const struct dictionary *dict = dataset_dict (ds);
+  struct resample *rs;
+  double *observed;
+  double *replicates;
+  struct ccase *c;
+
+  c = casereader_peek (input, 0);
+  if (c == NULL)
+    {
+      casereader_destroy (input);
+      return;
+    }
+  output_split_file_values (ds, c);
+  case_unref (c);
+
+  input = casereader_create_filter_weight (input, dict, NULL, NULL);
+  input = casereader_create_filter_missing (input, bs->vars, bs->n_vars,
+                                            bs->exclude, NULL, NULL);
+  rs = resample_create (input, bs->vars, bs->n_vars, bs->wv);
+
+  observed = xnmalloc (bs->n_vars, sizeof *observed);
+  mean_stat (rs, resample_get_weights (rs), observed, (void *) bs);
+
+  replicates = xnmalloc (bs->n_samples, bs->n_vars * sizeof *replicates);
+  resample_run (rs, seed, bs->n_samples, mean_stat, (void *) bs,
+                bs->n_vars, replicates);
+
+  bootstrap_output (bs, observed, replicates);
+
+  free (replicates);
+  free (observed);
+  resample_destroy (rs);
+}
+
+int
+cmd_bootstrap (struct lexer *lexer, struct dataset *ds)
+{
+  const struct dictionary *dict = dataset_dict (ds);
+  struct casegrouper *grouper;
+  struct casereader *group;
+  struct bootstrap bs;
+  bool ok;
+
+  bs.vars = NULL;
+  bs.n_vars = 0;
+  bs.wv = dict_get_weight (dict);
+  bs.n_samples = 1000;
+  bs.cilevel = 95.0;
+  bs.exclude = MV_ANY;
+
+  lex_match (lexer, T_SLASH);
+  if (!lex_force_match_id (lexer, "VARIABLES"))
+    goto error;
+  lex_match (lexer, T_EQUALS);
+  if (!parse_variables_const (lexer, dict, &bs.vars, &bs.n_vars,
+                              PV_NO_DUPLICATE | PV_NUMERIC))
+    goto error;
+
+  while (lex_token (lexer) != T_ENDCMD)
+    {
+      lex_match (lexer, T_SLASH);
+
+      if (lex_match_id (lexer, "CRITERIA"))
+        {
+          lex_match (lexer, T_EQUALS);
+          while (lex_token (lexer) != T_ENDCMD
+                 && lex_token (lexer) != T_SLASH)
+            {
+              if (lex_match_id (lexer, "NSAMPLES"))
+                {
+                  if (!lex_force_match (lexer, T_LPAREN)
+                      || !lex_force_int (lexer))
+                    goto error;
+                  bs.n_samples = lex_integer (lexer);
+                  if (bs.n_samples <= 0)
+                    {
+                      lex_error (lexer, _("The number of samples must be "
+                                          "positive"));
+                      goto error;
+                    }
+                  lex_get (lexer);
+                  if (!lex_force_match (lexer, T_RPAREN))
+                    goto error;
+                }
+              else if (lex_match_id (lexer, "CILEVEL"))
+                {
+                  if (!lex_force_match (lexer, T_LPAREN)
+                      || !lex_force_num (lexer))
+                    goto error;
+                  bs.cilevel = lex_number (lexer);
+                  if (bs.cilevel <= 0.0 || bs.cilevel >= 100.0)
+                    {
+                      lex_error (lexer, _("The confidence level must be "
+                                          "between 0 and 100"));
+                      goto error;
+                    }
+                  lex_get (lexer);
+                  if (!lex_force_match (lexer, T_RPAREN))
+                    goto error;
+                }
+              else
+                {
+                  lex_error (lexer, NULL);
+                  goto error;
+                }
+            }
+        }
+      else if (lex_match_id (lexer, "MISSING"))
+        {
+          lex_match (lexer, T_EQUALS);
+          while (lex_token (lexer) != T_ENDCMD
+                 && lex_token (lexer) != T_SLASH)
+            {
+              if (lex_match_id (lexer, "INCLUDE"))
+                bs.exclude = MV_SYSTEM;
+              else if (lex_match_id (lexer, "EXCLUDE"))
+                bs.exclude = MV_ANY;
+              else
+                {
+                  lex_error (lexer, NULL);
+                  goto error;
+                }
+            }
+        }
+      else
+        {
+          lex_error (lexer, NULL);
+          goto error;
+        }
+    }
+
+  /* Draw the base seed from PSPP's random number generator, so that SET
+     SEED makes the results reproducible.  Replicate i of split group g
+     uses seed + g * n_samples + i, so that each group gets replicates
+     of its own. */
+  {
+    unsigned long int seed = gsl_rng_get (get_rng ());
+
+    grouper = casegrouper_create_splits (proc_open (ds), dict);
+    while (casegrouper_get_next_group (grouper, &group))
+      {
+        bootstrap_group (&bs, group, ds, seed);
+        seed += bs.n_samples;
+      }
+    ok = casegrouper_destroy (grouper);
+    ok = proc_commit (ds) && ok;
+  }
+
+  free (bs.vars);
+  return ok ? CMD_SUCCESS : CMD_CASCADING_FAILURE;
+
+error:
+  free (bs.vars);
+  return CMD_FAILURE;
+}
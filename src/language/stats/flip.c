@@ -17,7 +17,6 @@
 #include <config.h>
 
 #include <ctype.h>
-#include <errno.h>
 #include <float.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -36,6 +35,7 @@
 #include "language/lexer/variable-parser.h"
 #include "libpspp/array.h"
 #include "libpspp/assertion.h"
+#include "libpspp/ext-array.h"
 #include "libpspp/message.h"
 #include "libpspp/misc.h"
 #include "libpspp/pool.h"
@@ -72,14 +72,32 @@ struct flip_pgm
     struct var_names old_names; /* Variable names before FLIP. */
     struct var_names new_names; /* Variable names after FLIP. */
 
-    FILE *file;                 /* Temporary file containing data. */
+    /* The data is transposed a block of cases at a time.  Each block
+       is stored in the temporary file as a "tile" that has one row of
+       'block_cases' values per pre-flip variable (fewer for the last
+       block). */
+    struct ext_array *file;     /* Temporary file containing tiles. */
+    size_t block_cases;         /* Number of cases per block. */
+    size_t n_blocks;            /* Number of tiles written. */
+    double *block;              /* Cases in current block, row-major. */
+    double *tile;               /* Transposed block. */
+    size_t block_fill;          /* Number of cases in 'block'. */
+
+    /* Flipped cases are assembled a group at a time from one row of
+       each tile. */
+    double *group;              /* Group of flipped cases, row-major. */
+    size_t group_cases;         /* Maximum number of cases per group. */
+    size_t group_start;         /* Index of first case in 'group'. */
+    size_t group_n;             /* Number of cases in 'group'. */
     size_t cases_read;          /* Number of cases already read. */
-    bool error;                 /* Error reading temporary file? */
+    bool error;                 /* I/O error on temporary file? */
   };
 
 static const struct casereader_class flip_casereader_class;
 
 static void destroy_flip_pgm (struct flip_pgm *);
+static void init_blocks (struct flip_pgm *, casenumber n_cases);
+static bool flush_block (struct flip_pgm *);
 static bool flip_file (struct flip_pgm *);
 static void make_new_var (struct dictionary *, const char *name);
 
@@ -107,6 +125,9 @@ cmd_flip (struct lexer *lexer, struct dataset *ds)
   var_names_init (&flip->old_names);
   var_names_init (&flip->new_names);
   flip->file = NULL;
+  flip->block = flip->tile = flip->group = NULL;
+  flip->n_blocks = flip->block_fill = 0;
+  flip->group_start = flip->group_n = 0;
   flip->cases_read = 0;
   flip->error = false;
 
@@ -145,8 +166,8 @@ cmd_flip (struct lexer *lexer, struct dataset *ds)
 	  }
     }
 
-  flip->file = pool_create_temp_file (flip->pool);
-  if (flip->file == NULL)
+  flip->file = ext_array_create ();
+  if (ext_array_error (flip->file))
     {
       msg (SE, _("Could not create temporary file for %s."), "FLIP");
       goto error;
@@ -167,14 +188,24 @@ cmd_flip (struct lexer *lexer, struct dataset *ds)
   dict_clear (new_dict);
 
   input = proc_open_filtering (ds, false);
+  init_blocks (flip, casereader_get_case_cnt (input));
   while ((c = casereader_read (input)) != NULL)
     {
+      double *row;
+
+      if (flip->block_fill >= flip->block_cases)
+        {
+          if (!flip->error)
+            flip->error = !flush_block (flip);
+          flip->block_fill = 0;
+        }
+
       flip->n_cases++;
+      row = &flip->block[flip->block_fill++ * flip->n_vars];
       for (i = 0; i < flip->n_vars; i++)
         {
           const struct variable *v = vars[i];
-          double out = var_is_numeric (v) ? case_num (c, v) : SYSMIS;
-          fwrite (&out, sizeof out, 1, flip->file);
+          row[i] = var_is_numeric (v) ? case_num (c, v) : SYSMIS;
         }
       if (flip->new_names_var != NULL)
         {
@@ -202,7 +233,7 @@ cmd_flip (struct lexer *lexer, struct dataset *ds)
   ok = proc_commit (ds) && ok;
 
   /* Flip the data we read. */
-  if (!ok || !flip_file (flip))
+  if (!ok || flip->error || !flip_file (flip))
     {
       dataset_clear (ds);
       goto error;
@@ -239,7 +270,11 @@ static void
 destroy_flip_pgm (struct flip_pgm *flip)
 {
   if (flip != NULL)
-    pool_destroy (flip->pool);
+    {
+      if (flip->file != NULL)
+        ext_array_destroy (flip->file);
+      pool_destroy (flip->pool);
+    }
 }
 
 /* Make a new variable with base name NAME, which is bowdlerized and
@@ -289,113 +324,145 @@ make_new_var (struct dictionary *dict, const char *name_)
   free (name);
 }
 
-/* Transposes the external file into a new file. */
-static bool
-flip_file (struct flip_pgm *flip)
+/* Number of rows and columns in the square tiles that transpose()
+   works through, chosen so that a tile of input and a tile of output
+   fit in the L1 cache together. */
+#define TRANSPOSE_TILE 32
+
+/* Transposes the N_ROWS by N_COLS matrix IN, stored in row-major
+   order, into OUT, so that OUT[j * N_ROWS + i] = IN[i * N_COLS + j].
+
+   Transposing row by row would touch a different cache line for every
+   element of OUT, so instead this works through the matrix in square
+   tiles. */
+static void
+transpose (const double *in, size_t n_rows, size_t n_cols, double *out)
 {
-  size_t case_bytes;
-  size_t case_capacity;
-  size_t case_idx;
-  double *input_buf, *output_buf;
-  FILE *input_file, *output_file;
-
-  /* Allocate memory for many cases. */
-  case_bytes = flip->n_vars * sizeof *input_buf;
-  case_capacity = settings_get_workspace () / case_bytes;
-  if (case_capacity > flip->n_cases * 2)
-    case_capacity = flip->n_cases * 2;
-  if (case_capacity < 2)
-    case_capacity = 2;
-  for (;;)
-    {
-      size_t bytes = case_bytes * case_capacity;
-      if (case_capacity > 2)
-        input_buf = malloc (bytes);
-      else
-        input_buf = xmalloc (bytes);
-      if (input_buf != NULL)
-	break;
-
-      case_capacity /= 2;
-      if (case_capacity < 2)
-	case_capacity = 2;
-    }
-  pool_register (flip->pool, free, input_buf);
+  size_t i0, j0;
 
-  /* Use half the allocated memory for input_buf, half for
-     output_buf. */
-  case_capacity /= 2;
-  output_buf = input_buf + flip->n_vars * case_capacity;
+  for (i0 = 0; i0 < n_rows; i0 += TRANSPOSE_TILE)
+    for (j0 = 0; j0 < n_cols; j0 += TRANSPOSE_TILE)
+      {
+        size_t i1 = MIN (i0 + TRANSPOSE_TILE, n_rows);
+        size_t j1 = MIN (j0 + TRANSPOSE_TILE, n_cols);
+        size_t i, j;
 
-  input_file = flip->file;
-  if (fseeko (input_file, 0, SEEK_SET) != 0)
-    {
-      msg (SE, _("Error rewinding %s file: %s."), "FLIP", strerror (errno));
-      return false;
-    }
+        for (j = j0; j < j1; j++)
+          for (i = i0; i < i1; i++)
+            out[j * n_rows + i] = in[i * n_cols + j];
+      }
+}
 
-  output_file = pool_create_temp_file (flip->pool);
-  if (output_file == NULL)
-    {
-      msg (SE, _("Error creating %s source file."), "FLIP");
-      return false;
-    }
+/* Allocates FLIP's buffers for blocks of input cases, using half of
+   the workspace for the cases and half for their transpose.  N_CASES
+   is the number of cases to be flipped, or CASENUMBER_MAX if it is not
+   known. */
+static void
+init_blocks (struct flip_pgm *flip, casenumber n_cases)
+{
+  size_t case_bytes = MAX (flip->n_vars, 1) * sizeof *flip->block;
+
+  flip->block_cases = settings_get_workspace () / 2 / case_bytes;
+  if (n_cases != CASENUMBER_MAX && flip->block_cases > n_cases)
+    flip->block_cases = n_cases;
+  if (flip->block_cases < 1)
+    flip->block_cases = 1;
+
+  flip->block = pool_nmalloc (flip->pool, flip->block_cases * flip->n_vars,
+                              sizeof *flip->block);
+  flip->tile = pool_nmalloc (flip->pool, flip->block_cases * flip->n_vars,
+                             sizeof *flip->tile);
+}
 
-  for (case_idx = 0; case_idx < flip->n_cases; )
-    {
-      unsigned long read_cases = MIN (flip->n_cases - case_idx,
-                                      case_capacity);
-      size_t i;
+/* Returns the byte offset in FLIP's temporary file of the tile for
+   block BLOCK_IDX, and stores the number of cases in that block into
+   *N_CASES. */
+static off_t
+tile_offset (const struct flip_pgm *flip, size_t block_idx, size_t *n_cases)
+{
+  size_t first = block_idx * flip->block_cases;
 
-      if (read_cases != fread (input_buf, case_bytes, read_cases, input_file))
-        {
-          if (ferror (input_file))
-            msg (SE, _("Error reading %s file: %s."), "FLIP", strerror (errno));
-          else
-            msg (SE, _("Unexpected end of file reading %s file."), "FLIP");
-          return false;
-        }
+  *n_cases = MIN (flip->block_cases, flip->n_cases - first);
+  return (off_t) first * flip->n_vars * sizeof *flip->tile;
+}
 
-      for (i = 0; i < flip->n_vars; i++)
-	{
-	  unsigned long j;
+/* Transposes the cases in FLIP's current block and appends them to
+   its temporary file as a tile.  Returns true if successful, false if
+   an I/O error occurred. */
+static bool
+flush_block (struct flip_pgm *flip)
+{
+  off_t offset = ((off_t) flip->n_blocks * flip->block_cases
+                  * flip->n_vars * sizeof *flip->tile);
 
-	  for (j = 0; j < read_cases; j++)
-	    output_buf[j] = input_buf[i + j * flip->n_vars];
+  if (flip->block_fill == 0)
+    return true;
 
-	  if (fseeko (output_file,
-                      sizeof *input_buf * (case_idx
-                                           + (off_t) i * flip->n_cases),
-                      SEEK_SET) != 0)
-            {
-              msg (SE, _("Error seeking %s source file: %s."), "FLIP",
-                   strerror (errno));
-              return false;
-            }
+  transpose (flip->block, flip->block_fill, flip->n_vars, flip->tile);
+  if (!ext_array_write (flip->file, offset,
+                        flip->block_fill * flip->n_vars * sizeof *flip->tile,
+                        flip->tile))
+    return false;
 
-	  if (fwrite (output_buf, sizeof *output_buf, read_cases, output_file)
-	      != read_cases)
-            {
-              msg (SE, _("Error writing %s source file: %s."), "FLIP",
-                   strerror (errno));
-              return false;
-            }
-	}
+  flip->n_blocks++;
+  flip->block_fill = 0;
+  return true;
+}
 
-      case_idx += read_cases;
-    }
+/* Finishes transposing the data in FLIP and prepares to read the
+   flipped cases.
+
+   Writing each block as a tile means that the data is written to the
+   temporary file once, sequentially.  Reading it back is also close to
+   sequential: each group of flipped cases takes one contiguous run of
+   rows from each tile. */
+static bool
+flip_file (struct flip_pgm *flip)
+{
+  if (!flush_block (flip))
+    return false;
+
+  pool_free (flip->pool, flip->block);
+  pool_free (flip->pool, flip->tile);
+  flip->block = flip->tile = NULL;
+
+  flip->group_cases = (settings_get_workspace ()
+                       / (MAX (flip->n_cases, 1) * sizeof *flip->group));
+  if (flip->group_cases > flip->n_vars)
+    flip->group_cases = flip->n_vars;
+  if (flip->group_cases < 1)
+    flip->group_cases = 1;
+  flip->group = pool_nmalloc (flip->pool,
+                              flip->group_cases * flip->n_cases,
+                              sizeof *flip->group);
+
+  return true;
+}
 
-  pool_fclose_temp_file (flip->pool, input_file);
-  pool_unregister (flip->pool, input_buf);
-  free (input_buf);
+/* Reads the group of flipped cases that begins with case FIRST into
+   FLIP's group buffer.  Returns true if successful, false if an I/O
+   error occurred. */
+static bool
+read_group (struct flip_pgm *flip, size_t first)
+{
+  size_t i, j;
 
-  if (fseeko (output_file, 0, SEEK_SET) != 0)
+  flip->group_start = first;
+  flip->group_n = MIN (flip->group_cases, flip->n_vars - first);
+  for (i = 0; i < flip->n_blocks; i++)
     {
-      msg (SE, _("Error rewinding %s source file: %s."), "FLIP", strerror (errno));
-      return false;
+      size_t n_cases;
+      off_t offset = tile_offset (flip, i, &n_cases);
+
+      for (j = 0; j < flip->group_n; j++)
+        if (!ext_array_read (flip->file,
+                             offset + ((off_t) (first + j) * n_cases
+                                       * sizeof *flip->group),
+                             n_cases * sizeof *flip->group,
+                             &flip->group[j * flip->n_cases
+                                          + i * flip->block_cases]))
+          return false;
     }
-  flip->file = output_file;
-
   return true;
 }
 
@@ -405,34 +472,26 @@ static struct ccase *
 flip_casereader_read (struct casereader *reader, void *flip_)
 {
   struct flip_pgm *flip = flip_;
+  const double *row;
   struct ccase *c;
   size_t i;
 
   if (flip->error || flip->cases_read >= flip->n_vars)
-    return false;
+    return NULL;
+
+  if (flip->cases_read >= flip->group_start + flip->group_n
+      && !read_group (flip, flip->cases_read))
+    {
+      flip->error = true;
+      return NULL;
+    }
+  row = &flip->group[(flip->cases_read - flip->group_start) * flip->n_cases];
 
   c = case_create (casereader_get_proto (reader));
   data_in (ss_cstr (flip->old_names.names[flip->cases_read]), flip->encoding,
            FMT_A, case_data_rw_idx (c, 0), 8, flip->encoding);
-
   for (i = 0; i < flip->n_cases; i++)
-    {
-      double in;
-      if (fread (&in, sizeof in, 1, flip->file) != 1)
-        {
-          case_unref (c);
-          if (ferror (flip->file))
-            msg (SE, _("Error reading %s temporary file: %s."), "FLIP",
-                 strerror (errno));
-          else if (feof (flip->file))
-            msg (SE, _("Unexpected end of file reading %s temporary file."), "FLIP");
-          else
-            NOT_REACHED ();
-          flip->error = true;
-          return NULL;
-        }
-      case_data_rw_idx (c, i + 1)->f = in;
-    }
+    case_data_rw_idx (c, i + 1)->f = row[i];
 
   flip->cases_read++;
 
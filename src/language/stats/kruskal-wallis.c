@@ -34,6 +34,7 @@
 #include "libpspp/bt.h"
 #include "libpspp/message.h"
 #include "libpspp/misc.h"
+#include "math/column-ranks.h"
 #include "math/sort.h"
 #include "output/tab.h"
 
@@ -116,6 +117,29 @@ struct kw
 static void show_ranks_box (const struct n_sample_test *nst, const struct kw *kw, int n_groups);
 static void show_sig_box (const struct n_sample_test *nst, const struct kw *kw);
 
+/* Adds case C, with the given WEIGHT and RANK, to the sum of ranks for
+   its group in KW. */
+static void
+kw_add_case (struct kw *kw, const struct n_sample_test *nst,
+             const struct ccase *c, double rank, double weight)
+{
+  const union value *group = case_data (c, nst->indep_var);
+  const size_t group_var_width = var_get_width (nst->indep_var);
+  struct rank_entry *re = find_rank_entry (&kw->map, group, group_var_width);
+
+  if ( NULL == re)
+    {
+      re = xzalloc (sizeof *re);
+      value_clone (&re->group, group, group_var_width);
+
+      hmap_insert (&kw->map, &re->node,
+                   value_hash (&re->group, group_var_width, 0));
+    }
+
+  re->sum_of_ranks += rank;
+  re->n += weight;
+}
+
 void
 kruskal_wallis_execute (const struct dataset *ds,
 			struct casereader *input,
@@ -135,6 +159,8 @@ kruskal_wallis_execute (const struct dataset *ds,
   int total_n_groups = 0.0;
 
   struct kw *kw = xcalloc (nst->n_vars, sizeof *kw);
+  double *tiebreaker = xcalloc (nst->n_vars, sizeof *tiebreaker);
+  struct column_ranks *cr;
 
   /* If the independent variable is missing, then we ignore the case */
   input = casereader_create_filter_missing (input, 
@@ -151,54 +177,72 @@ kruskal_wallis_execute (const struct dataset *ds,
   proto = casereader_get_proto (input);
   rank_idx = caseproto_get_n_widths (proto);
 
-  /* Rank cases by the v value */
   for (i = 0; i < nst->n_vars; ++i)
-    {
-      double tiebreaker = 0.0;
-      bool warn = true;
-      enum rank_error rerr = 0;
-      struct casereader *rr;
-      struct casereader *r = casereader_clone (input);
-
-      r = sort_execute_1var (r, nst->vars[i]);
-
-      /* Ignore missings in the test variable */
-      r = casereader_create_filter_missing (r, &nst->vars[i], 1,
-					    exclude,
-					    NULL, NULL);
+    hmap_init (&kw[i].map);
 
-      rr = casereader_create_append_rank (r, 
-					  nst->vars[i],
-					  dict_get_weight (dict),
-					  &rerr,
-					  distinct_callback, &tiebreaker);
-
-      hmap_init (&kw[i].map);
-      for (; (c = casereader_read (rr)); case_unref (c))
-	{
-	  const union value *group = case_data (c, nst->indep_var);
-	  const size_t group_var_width = var_get_width (nst->indep_var);
-	  struct rank_entry *rank = find_rank_entry (&kw[i].map, group, group_var_width); 
-
-	  if ( NULL == rank)
-	    {
-	      rank = xzalloc (sizeof *rank);
-	      value_clone (&rank->group, group, group_var_width);
-
-	      hmap_insert (&kw[i].map, &rank->node,
-			   value_hash (&rank->group, group_var_width, 0));
-	    }
-
-	  rank->sum_of_ranks += case_data_idx (c, rank_idx)->f;
-	  rank->n += dict_get_case_weight (dict, c, &warn);
+  /* Rank cases by the v value, for all the variables together if they
+     fit in memory. */
+  cr = column_ranks_create (casereader_clone (input), nst->vars, nst->n_vars,
+                            dict_get_weight (dict), exclude);
+  if (cr != NULL)
+    {
+      struct casereader *reader = casereader_clone (input);
+      casenumber row;
 
-	  /* If this assertion fires, then either the data wasn't sorted or some other
-	     problem occured */
-	  assert (rerr == 0);
-	}
+      for (row = 0; (c = casereader_read (reader)) != NULL; row++)
+        {
+          double weight = dict_get_case_weight (dict, c, &warn);
+
+          for (i = 0; i < nst->n_vars; ++i)
+            {
+              double rank = column_ranks_get (cr, i, row);
+              if (rank != SYSMIS)
+                kw_add_case (&kw[i], nst, c, rank, weight);
+            }
+          case_unref (c);
+        }
+      casereader_destroy (reader);
 
-      casereader_destroy (rr);
+      for (i = 0; i < nst->n_vars; ++i)
+        column_ranks_visit_ties (cr, i, distinct_callback, &tiebreaker[i]);
+      column_ranks_destroy (cr);
+    }
+  else
+    for (i = 0; i < nst->n_vars; ++i)
+      {
+        bool warn = true;
+        enum rank_error rerr = 0;
+        struct casereader *rr;
+        struct casereader *r = casereader_clone (input);
+
+        r = sort_execute_1var (r, nst->vars[i]);
+
+        /* Ignore missings in the test variable */
+        r = casereader_create_filter_missing (r, &nst->vars[i], 1,
+                                              exclude,
+                                              NULL, NULL);
+
+        rr = casereader_create_append_rank (r,
+                                            nst->vars[i],
+                                            dict_get_weight (dict),
+                                            &rerr,
+                                            distinct_callback, &tiebreaker[i]);
+
+        for (; (c = casereader_read (rr)); case_unref (c))
+          {
+            kw_add_case (&kw[i], nst, c, case_data_idx (c, rank_idx)->f,
+                         dict_get_case_weight (dict, c, &warn));
+
+            /* If this assertion fires, then either the data wasn't
+               sorted or some other problem occured */
+            assert (rerr == 0);
+          }
+
+        casereader_destroy (rr);
+      }
 
+  for (i = 0; i < nst->n_vars; ++i)
+    {
       /* Calculate the value of h */
       {
 	struct rank_entry *mre;
@@ -214,10 +258,11 @@ kruskal_wallis_execute (const struct dataset *ds,
 	kw[i].h *= 12 / (n * ( n + 1));
 	kw[i].h -= 3 * (n + 1) ; 
 
-	kw[i].h /= 1 - tiebreaker/ (pow3 (n) - n);
+	kw[i].h /= 1 - tiebreaker[i] / (pow3 (n) - n);
       }
     }
 
+  free (tiebreaker);
   casereader_destroy (input);
   
   show_ranks_box (nst, kw, total_n_groups);
@@ -53,6 +53,7 @@
 #include "data/dataset.h"
 #include "data/dictionary.h"
 #include "data/format.h"
+#include "data/settings.h"
 #include "data/value.h"
 #include "language/command.h"
 #include "language/dictionary/split-file.h"
@@ -64,6 +65,7 @@
 #include "libpspp/message.h"
 #include "libpspp/misc.h"
 #include "math/categoricals.h"
+#include "math/covariate-patterns.h"
 #include "math/interaction.h"
 #include "libpspp/hmap.h"
 #include "libpspp/hash-functions.h"
@@ -241,162 +243,318 @@ predictor_value (const struct ccase *c,
 }
 
 
-/*
-  Return the probability beta_hat (that is the estimator logit(y) )
-  corresponding to the coefficient estimator for case C
-*/
-static double 
-pi_hat (const struct lr_spec *cmd, 
-	const struct lr_result *res,
-	const struct variable **x, size_t n_x,
-	const struct ccase *c)
+/* The design matrix of the model, together with the dependent
+   variable and the case weights, read from the data once so that
+   each Newton-Raphson iteration does not have to read the data
+   again.
+
+   If the matrix would not fit in the workspace, then INPUT is
+   nonnull and each iteration reads the cases from INPUT instead,
+   using ROW to hold the predictor values for one case at a time. */
+struct lr_data
 {
-  int v0;
-  double pi = 0;
-  size_t n_coeffs = res->beta_hat->size;
+  size_t n_cases;               /* Number of cases. */
+  size_t allocated_cases;       /* Number of cases allocated. */
+  size_t max_cases;             /* Maximum cases that fit in workspace. */
+  size_t n_coeffs;              /* Number of coefficients in the model. */
+  struct casereader *input;     /* Data to read, if not in memory. */
+  double *row;                  /* Predictor values for one case. */
+
+  /* N_CASES x N_COEFFS matrix, stored row by row: the value of each
+     coefficient's predictor for each case. */
+  double *x;
+
+  double *y;                    /* Mapped dependent variable: 0 or 1. */
+  double *weight;               /* Case weights. */
+};
 
-  if (cmd->constant)
-    {
-      pi += gsl_vector_get (res->beta_hat, res->beta_hat->size - 1);
-      n_coeffs--;
-    }
-  
-  for (v0 = 0; v0 < n_coeffs; ++v0)
+/* Stores into ROW the value of each of the N_COEFFS predictors for
+   case C, expanding the categorical predictors into their dummy
+   codes. */
+static void
+lr_fill_row (const struct lr_spec *cmd, const struct lr_result *res,
+             size_t n_coeffs, const struct ccase *c, double *row)
+{
+  size_t v;
+
+  for (v = 0; v < n_coeffs; ++v)
+    row[v] = predictor_value (c, cmd->predictor_vars,
+                              cmd->n_predictor_vars, res->cats, v);
+}
+
+/* Appends a row to DATA for case C, with the given WEIGHT, mapping
+   the dependent variable through RES and expanding the categorical
+   predictors into their dummy codes.
+
+   Returns false, without appending anything, if DATA already holds
+   as many rows as fit in the workspace. */
+static bool
+lr_data_add (const struct lr_spec *cmd, const struct lr_result *res,
+             struct lr_data *data, const struct ccase *c, double weight)
+{
+  if (data->n_cases >= data->max_cases)
+    return false;
+
+  if (data->n_cases >= data->allocated_cases)
     {
-      pi += gsl_vector_get (res->beta_hat, v0) * 
-	predictor_value (c, x, n_x, res->cats, v0);
+      data->y = x2nrealloc (data->y, &data->allocated_cases,
+                            sizeof *data->y);
+      data->weight = xnrealloc (data->weight, data->allocated_cases,
+                                sizeof *data->weight);
+      data->x = xnrealloc (data->x, data->allocated_cases,
+                           data->n_coeffs * sizeof *data->x);
     }
 
-  pi = 1.0 / (1.0 + exp(-pi));
+  lr_fill_row (cmd, res, data->n_coeffs, c,
+               &data->x[data->n_cases * data->n_coeffs]);
+  data->y[data->n_cases] = map_dependent_var (cmd, res,
+                                              case_data (c, cmd->dep_var));
+  data->weight[data->n_cases] = weight;
+  data->n_cases++;
+  return true;
+}
 
-  return pi;
+/* Discards the rows already in DATA and arranges for the fit to read
+   the cases from INPUT on every iteration instead. */
+static void
+lr_data_stream (struct lr_data *data, struct casereader *input)
+{
+  free (data->x);
+  free (data->y);
+  free (data->weight);
+  data->x = data->y = data->weight = NULL;
+  data->n_cases = data->allocated_cases = 0;
+
+  data->input = input;
+  data->row = xnmalloc (data->n_coeffs, sizeof *data->row);
 }
 
+/* Reads the cases in INPUT into DATA.
 
-/*
-  Calculates the Hessian matrix X' V  X,
-  where: X is the n by N_X matrix comprising the n cases in INPUT
-  V is a diagonal matrix { (pi_hat_0)(1 - pi_hat_0), (pi_hat_1)(1 - pi_hat_1), ... (pi_hat_{N-1})(1 - pi_hat_{N-1})} 
-  (the partial derivative of the predicted values)
+   If all of the predictors are categorical, then cases that have
+   the same values for all of the independent variables and the
+   dependent variable contribute identically to every sum that the
+   fit needs, so each such covariate pattern becomes a single row,
+   weighted by the total weight of its cases.
 
-  If ALL predicted values derivatives are close to zero or one, then CONVERGED
-  will be set to true.
-*/
+   If the rows do not all fit in the workspace, DATA instead refers
+   to INPUT, which must then remain valid until DATA is destroyed. */
 static void
-hessian (const struct lr_spec *cmd, 
-	 struct lr_result *res,
-	 struct casereader *input,
-	 const struct variable **x, size_t n_x,
-	 bool *converged)
+lr_data_init (const struct lr_spec *cmd, struct lr_result *res,
+              struct casereader *input, struct lr_data *data)
 {
   struct casereader *reader;
   struct ccase *c;
+  bool fits = true;
+
+  data->n_cases = data->allocated_cases = 0;
+  data->n_coeffs = res->beta_hat->size;
+  data->max_cases = settings_get_workspace () / ((data->n_coeffs + 2)
+                                                 * sizeof (double));
+  data->input = NULL;
+  data->row = NULL;
+  data->x = NULL;
+  data->y = NULL;
+  data->weight = NULL;
+
+  reader = casereader_clone (input);
+  if (cmd->n_predictor_vars == 0 && res->cats != NULL)
+    {
+      struct covariate_patterns *patterns;
+      struct interaction *key;
+      size_t i;
+
+      key = interaction_create (cmd->dep_var);
+      for (i = 0; i < cmd->n_indep_vars; ++i)
+        interaction_add_variable (key, cmd->indep_vars[i]);
+      patterns = covariate_patterns_create (key);
+      interaction_destroy (key);
+
+      for (; (c = casereader_read (reader)) != NULL; case_unref (c))
+        {
+          covariate_patterns_add (patterns, c,
+                                  dict_get_case_weight (cmd->dict, c,
+                                                        &res->warn_bad_weight));
+          if (covariate_patterns_count (patterns) > data->max_cases)
+            {
+              fits = false;
+              case_unref (c);
+              break;
+            }
+        }
+
+      for (i = 0; fits && i < covariate_patterns_count (patterns); ++i)
+        {
+          const struct covariate_pattern *p
+            = covariate_patterns_get (patterns, i);
+          lr_data_add (cmd, res, data, p->c, p->n);
+        }
+      covariate_patterns_destroy (patterns);
+    }
+  else
+    {
+      for (; (c = casereader_read (reader)) != NULL; case_unref (c))
+        if (!lr_data_add (cmd, res, data, c,
+                          dict_get_case_weight (cmd->dict, c,
+                                                &res->warn_bad_weight)))
+          {
+            fits = false;
+            case_unref (c);
+            break;
+          }
+    }
+  casereader_destroy (reader);
 
-  double max_w = -DBL_MAX;
+  if (!fits)
+    lr_data_stream (data, input);
+}
 
-  gsl_matrix_set_zero (res->hessian);
+/* Frees the data in DATA. */
+static void
+lr_data_destroy (struct lr_data *data)
+{
+  free (data->x);
+  free (data->y);
+  free (data->weight);
+  free (data->row);
+}
 
-  for (reader = casereader_clone (input);
-       (c = casereader_read (reader)) != NULL; case_unref (c))
+/* Adds to the sums accumulated by newton_pass() the contribution of
+   one case or covariate pattern, whose predictor values are in ROW,
+   whose mapped dependent variable is Y, and whose weight is WEIGHT. */
+static void
+newton_add_row (const struct lr_spec *cmd, struct lr_result *res,
+                size_t n_coeffs, const double *row, double y, double weight,
+                double *out, double *llikelihood, double *max_w)
+{
+  const double *beta = gsl_vector_const_ptr (res->beta_hat, 0);
+  size_t n_terms = n_coeffs;
+  double pred_y = 0;
+  double pi = 0;
+  double w;
+  size_t v0, v1;
+
+  /* Calculate pi_hat, the probability corresponding to the
+     estimator logit(y). */
+  if (cmd->constant)
     {
-      int v0, v1;
-      double pi = pi_hat (cmd, res, x, n_x, c);
+      pi += beta[n_coeffs - 1];
+      n_terms--;
+    }
+  for (v0 = 0; v0 < n_terms; ++v0)
+    pi += beta[v0] * row[v0];
+  pi = 1.0 / (1.0 + exp(-pi));
 
-      double weight = dict_get_case_weight (cmd->dict, c, &res->warn_bad_weight);
-      double w = pi * (1 - pi);
-      if (w > max_w)
-	max_w = w;
-      w *= weight;
+  w = pi * (1 - pi);
+  if (w > *max_w)
+    *max_w = w;
+  w *= weight;
 
-      for (v0 = 0; v0 < res->beta_hat->size; ++v0)
-	{
-	  double in0 = predictor_value (c, x, n_x, res->cats, v0);
-	  for (v1 = 0; v1 < res->beta_hat->size; ++v1)
-	    {
-	      double in1 = predictor_value (c, x, n_x, res->cats, v1);
-	      double *o = gsl_matrix_ptr (res->hessian, v0, v1);
-	      *o += in0 * w * in1;
-	    }
-	}
+  for (v0 = 0; v0 < n_coeffs; ++v0)
+    {
+      double *o = gsl_matrix_ptr (res->hessian, v0, 0);
+      double in0 = row[v0];
+
+      for (v1 = 0; v1 < n_coeffs; ++v1)
+        o[v1] += in0 * w * row[v1];
     }
-  casereader_destroy (reader);
 
-  if ( max_w < cmd->min_epsilon)
+  *llikelihood += (weight * y) * log (pi) + log (1 - pi) * weight * (1 - y);
+
+  for (v0 = 0; v0 < n_coeffs; ++v0)
     {
-      *converged = true;
-      msg (MN, _("All predicted values are either 1 or 0"));
+      out[v0] += row[v0] * (y - pi) * weight;
+      pred_y += beta[v0] * row[v0];
+    }
+
+  /* Count the number of cases which would be correctly/incorrectly classified by this
+     estimated model */
+  if (pred_y <= cmd->ilogit_cut_point)
+    {
+      if (y == 0)
+        res->tn += weight;
+      else
+        res->fn += weight;
+    }
+  else
+    {
+      if (y == 0)
+        res->fp += weight;
+      else
+        res->tp += weight;
     }
 }
 
+/*
+  Makes one pass through DATA, calculating at the same time, for the
+  current estimates in RES->beta_hat:
+
+  - The Hessian matrix X' V X, stored in RES->hessian,
+    where: X is the n by N_COEFFS design matrix in DATA
+    V is a diagonal matrix { (pi_hat_0)(1 - pi_hat_0), (pi_hat_1)(1 - pi_hat_1), ... (pi_hat_{N-1})(1 - pi_hat_{N-1})}
+    (the partial derivative of the predicted values)
 
-/* Calculates the value  X' (y - pi)
-   where X is the design model, 
-   y is the vector of observed independent variables
-   pi is the vector of estimates for y
+  - The value X' (y - pi), which is returned,
+    where y is the vector of observed dependent variables
+    pi is the vector of estimates for y
 
-   Side effects:
-     the likelihood is stored in LIKELIHOOD;
-     the predicted values are placed in the respective tn, fn, tp fp values in RES
+  Side effects:
+    the log likelihood is stored in LLIKELIHOOD;
+    the predicted values are placed in the respective tn, fn, tp fp values in RES.
+
+  If ALL predicted values derivatives are close to zero or one, then CONVERGED
+  will be set to true.
 */
 static gsl_vector *
-xt_times_y_pi (const struct lr_spec *cmd,
-	       struct lr_result *res,
-	       struct casereader *input,
-	       const struct variable **x, size_t n_x,
-	       const struct variable *y_var,
-	       double *llikelihood)
+newton_pass (const struct lr_spec *cmd, struct lr_result *res,
+             const struct lr_data *data, double *llikelihood,
+             bool *converged)
 {
-  struct casereader *reader;
-  struct ccase *c;
-  gsl_vector *output = gsl_vector_calloc (res->beta_hat->size);
+  const size_t n_coeffs = data->n_coeffs;
+  gsl_vector *output = gsl_vector_calloc (n_coeffs);
+  double *out = gsl_vector_ptr (output, 0);
+  double max_w = -DBL_MAX;
 
+  gsl_matrix_set_zero (res->hessian);
   *llikelihood = 0.0;
   res->tn = res->tp = res->fn = res->fp = 0;
-  for (reader = casereader_clone (input);
-       (c = casereader_read (reader)) != NULL; case_unref (c))
-    {
-      double pred_y = 0;
-      int v0;
-      double pi = pi_hat (cmd, res, x, n_x, c);
-      double weight = dict_get_case_weight (cmd->dict, c, &res->warn_bad_weight);
-
-
-      double y = map_dependent_var (cmd, res, case_data (c, y_var));
 
-      *llikelihood += (weight * y) * log (pi) + log (1 - pi) * weight * (1 - y);
-
-      for (v0 = 0; v0 < res->beta_hat->size; ++v0)
-	{
-	  double in0 = predictor_value (c, x, n_x, res->cats, v0);
-	  double *o = gsl_vector_ptr (output, v0);
-      	  *o += in0 * (y - pi) * weight;
-	  pred_y += gsl_vector_get (res->beta_hat, v0) * in0;
-	}
+  if (data->input != NULL)
+    {
+      struct casereader *reader = casereader_clone (data->input);
+      struct ccase *c;
+
+      for (; (c = casereader_read (reader)) != NULL; case_unref (c))
+        {
+          double weight = dict_get_case_weight (cmd->dict, c,
+                                                &res->warn_bad_weight);
+          double y = map_dependent_var (cmd, res, case_data (c, cmd->dep_var));
+
+          lr_fill_row (cmd, res, n_coeffs, c, data->row);
+          newton_add_row (cmd, res, n_coeffs, data->row, y, weight,
+                          out, llikelihood, &max_w);
+        }
+      casereader_destroy (reader);
+    }
+  else
+    {
+      size_t i;
 
-      /* Count the number of cases which would be correctly/incorrectly classified by this
-	 estimated model */
-      if (pred_y <= cmd->ilogit_cut_point)
-	{
-	  if (y == 0)
-	    res->tn += weight;
-	  else
-	    res->fn += weight;
-	}
-      else
-	{
-	  if (y == 0)
-	    res->fp += weight;
-	  else
-	    res->tp += weight;
-	}
+      for (i = 0; i < data->n_cases; ++i)
+        newton_add_row (cmd, res, n_coeffs, &data->x[i * n_coeffs],
+                        data->y[i], data->weight[i],
+                        out, llikelihood, &max_w);
     }
 
-  casereader_destroy (reader);
+  if ( max_w < cmd->min_epsilon)
+    {
+      *converged = true;
+      msg (MN, _("All predicted values are either 1 or 0"));
+    }
 
   return output;
 }
 
-
 
 /* "payload" functions for the categoricals.
    The only function is to accumulate the frequency of each
@@ -589,6 +747,7 @@ run_lr (const struct lr_spec *cmd, struct casereader *input,
   double prev_log_likelihood = SYSMIS;
   double initial_log_likelihood = SYSMIS;
 
+  struct lr_data data;
   struct lr_result work;
   work.n_missing = 0;
   work.n_nonmissing = 0;
@@ -639,25 +798,19 @@ run_lr (const struct lr_spec *cmd, struct casereader *input,
 
   work.hessian = gsl_matrix_calloc (work.beta_hat->size, work.beta_hat->size);
 
+  lr_data_init (cmd, &work, input, &data);
+
   /* Start the Newton Raphson iteration process... */
   for( i = 0 ; i < cmd->max_iter ; ++i)
     {
       double min, max;
       gsl_vector *v ;
 
-      
-      hessian (cmd, &work, input,
-	       cmd->predictor_vars, cmd->n_predictor_vars,
-	       &converged);
+      v = newton_pass (cmd, &work, &data, &log_likelihood, &converged);
 
       gsl_linalg_cholesky_decomp (work.hessian);
       gsl_linalg_cholesky_invert (work.hessian);
 
-      v = xt_times_y_pi (cmd, &work, input,
-			 cmd->predictor_vars, cmd->n_predictor_vars,
-			 cmd->dep_var,
-			 &log_likelihood);
-
       {
 	/* delta = M.v */
 	gsl_vector *delta = gsl_vector_alloc (v->size);
@@ -709,6 +862,7 @@ run_lr (const struct lr_spec *cmd, struct casereader *input,
   output_classification_table (cmd, &work);
   output_variables (cmd, &work);
 
+  lr_data_destroy (&data);
   casereader_destroy (input);
   gsl_matrix_free (work.hessian);
   gsl_vector_free (work.beta_hat); 
@@ -28,6 +28,7 @@
 #include "data/variable.h"
 #include "libpspp/cast.h"
 #include "libpspp/misc.h"
+#include "math/column-ranks.h"
 #include "math/sort.h"
 #include "output/tab.h"
 
@@ -54,6 +55,32 @@ static void show_ranks_box (const struct n_sample_test *nst, const struct mw *mw
 static void show_statistics_box (const struct n_sample_test *nst, const struct mw *mw, bool exact);
 
 
+/* Adds case C, with the given WEIGHT, whose rank within VAR is RANK,
+   to MW. */
+static void
+mw_add_case (struct mw *mw, const struct n_sample_test *nst,
+             const struct variable *var, enum mv_class exclude,
+             const struct ccase *c, double rank, double weight)
+{
+  const union value *val = case_data (c, var);
+  const union value *group = case_data (c, nst->indep_var);
+  const size_t group_var_width = var_get_width (nst->indep_var);
+
+  if ( var_is_value_missing (var, val, exclude))
+    return;
+
+  if ( value_equal (group, &nst->val1, group_var_width))
+    {
+      mw->rank_sum[0] += rank;
+      mw->n[0] += weight;
+    }
+  else if ( value_equal (group, &nst->val2, group_var_width))
+    {
+      mw->rank_sum[1] += rank;
+      mw->n[1] += weight;
+    }
+}
+
 void
 mann_whitney_execute (const struct dataset *ds,
 		      struct casereader *input,
@@ -70,73 +97,85 @@ mann_whitney_execute (const struct dataset *ds,
   size_t rank_idx = caseproto_get_n_widths (proto);
 
   struct mw *mw = xcalloc (nst->n_vars, sizeof *mw);
+  double *tiebreaker = xcalloc (nst->n_vars, sizeof *tiebreaker);
+  struct column_ranks *cr;
 
-  for (i = 0; i < nst->n_vars; ++i)
+  /* Rank all of the variables together, if they fit in memory. */
+  cr = column_ranks_create (casereader_clone (input), nst->vars, nst->n_vars,
+                            dict_get_weight (dict), MV_NEVER);
+  if (cr != NULL)
     {
-      double tiebreaker = 0.0;
+      struct casereader *reader = casereader_clone (input);
+      casenumber row;
       bool warn = true;
-      enum rank_error rerr = 0;
-      struct casereader *rr;
       struct ccase *c;
-      const struct variable *var = nst->vars[i];
-      
-      struct casereader *reader =
-	sort_execute_1var (casereader_clone (input), var);
-
-      rr = casereader_create_append_rank (reader, var,
-					  dict_get_weight (dict),
-					  &rerr,
-					  distinct_callback, &tiebreaker);
-
-      for (; (c = casereader_read (rr)); case_unref (c))
-	{
-	  const union value *val = case_data (c, var);
-	  const union value *group = case_data (c, nst->indep_var);
-	  const size_t group_var_width = var_get_width (nst->indep_var);
-	  const double rank = case_data_idx (c, rank_idx)->f;
-
-	  if ( var_is_value_missing (var, val, exclude))
-	    continue;
-
-	  if ( value_equal (group, &nst->val1, group_var_width))
-	    {
-	      mw[i].rank_sum[0] += rank;
-	      mw[i].n[0] += dict_get_case_weight (dict, c, &warn);
-	    }
-	  else if ( value_equal (group, &nst->val2, group_var_width))
-	    {
-	      mw[i].rank_sum[1] += rank;
-	      mw[i].n[1] += dict_get_case_weight (dict, c, &warn);
-	    }
-	}
-      casereader_destroy (rr);
 
+      for (row = 0; (c = casereader_read (reader)) != NULL; row++)
+        {
+          double weight = dict_get_case_weight (dict, c, &warn);
+
+          for (i = 0; i < nst->n_vars; ++i)
+            mw_add_case (&mw[i], nst, nst->vars[i], exclude, c,
+                         column_ranks_get (cr, i, row), weight);
+          case_unref (c);
+        }
+      casereader_destroy (reader);
+
+      for (i = 0; i < nst->n_vars; ++i)
+        column_ranks_visit_ties (cr, i, distinct_callback, &tiebreaker[i]);
+      column_ranks_destroy (cr);
+    }
+  else
+    for (i = 0; i < nst->n_vars; ++i)
       {
-	double n;
-	double denominator;
-	struct mw *mwv = &mw[i];
-
-	mwv->u = mwv->n[0] * mwv->n[1] ;
-	mwv->u += mwv->n[0] * (mwv->n[0] + 1) / 2.0;
-	mwv->u -= mwv->rank_sum[0];
-
-	mwv->w = mwv->rank_sum[1];
-	if ( mwv->u > mwv->n[0] * mwv->n[1] / 2.0)
-	  {
-	    mwv->u =  mwv->n[0] * mwv->n[1] - mwv->u;
-	    mwv->w = mwv->rank_sum[0];
-	  }
-	mwv->z = mwv->u - mwv->n[0] * mwv->n[1] / 2.0;
-	n = mwv->n[0] + mwv->n[1];
-	denominator = pow3(n) - n;
-	denominator /= 12;
-	denominator -= tiebreaker;
-	denominator *= mwv->n[0] * mwv->n[1];
-	denominator /= n * (n - 1);
-      
-	mwv->z /= sqrt (denominator);
+        bool warn = true;
+        enum rank_error rerr = 0;
+        struct casereader *rr;
+        struct ccase *c;
+        const struct variable *var = nst->vars[i];
+
+        struct casereader *reader =
+          sort_execute_1var (casereader_clone (input), var);
+
+        rr = casereader_create_append_rank (reader, var,
+                                            dict_get_weight (dict),
+                                            &rerr,
+                                            distinct_callback, &tiebreaker[i]);
+
+        for (; (c = casereader_read (rr)); case_unref (c))
+          mw_add_case (&mw[i], nst, var, exclude, c,
+                       case_data_idx (c, rank_idx)->f,
+                       dict_get_case_weight (dict, c, &warn));
+        casereader_destroy (rr);
       }
+
+  for (i = 0; i < nst->n_vars; ++i)
+    {
+      double n;
+      double denominator;
+      struct mw *mwv = &mw[i];
+
+      mwv->u = mwv->n[0] * mwv->n[1] ;
+      mwv->u += mwv->n[0] * (mwv->n[0] + 1) / 2.0;
+      mwv->u -= mwv->rank_sum[0];
+
+      mwv->w = mwv->rank_sum[1];
+      if ( mwv->u > mwv->n[0] * mwv->n[1] / 2.0)
+        {
+          mwv->u =  mwv->n[0] * mwv->n[1] - mwv->u;
+          mwv->w = mwv->rank_sum[0];
+        }
+      mwv->z = mwv->u - mwv->n[0] * mwv->n[1] / 2.0;
+      n = mwv->n[0] + mwv->n[1];
+      denominator = pow3(n) - n;
+      denominator /= 12;
+      denominator -= tiebreaker[i];
+      denominator *= mwv->n[0] * mwv->n[1];
+      denominator /= n * (n - 1);
+
+      mwv->z /= sqrt (denominator);
     }
+  free (tiebreaker);
   casereader_destroy (input);
 
   show_ranks_box (nst, mw);
@@ -692,6 +692,7 @@ run_oneway (const struct oneway_spec *cmd,
   struct dictionary *dict = dataset_dict (ds);
   struct casereader *reader;
   struct ccase *c;
+  bool need_levene_passes;
 
   struct oneway_workspace ws;
 
@@ -762,16 +763,22 @@ run_oneway (const struct oneway_spec *cmd,
 	    }
 
 	  covariance_accumulate_pass1 (pvw->cov, c);
-	  levene_pass_one (pvw->nl, val->f, w, case_data (c, cmd->indep_var));
+	  levene_accumulate (pvw->nl, val->f, w, case_data (c, cmd->indep_var));
 	}
     }
   casereader_destroy (reader);
 
+  need_levene_passes = false;
+  for (v = 0; v < cmd->n_vars; ++v)
+    if (levene_needs_passes (ws.vws[v].nl))
+      need_levene_passes = true;
+
   reader = casereader_clone (input);
   for ( ; (c = casereader_read (reader) ); case_unref (c))
     {
       int i;
       double w = dict_get_case_weight (dict, c, NULL);
+
       for (i = 0; i < cmd->n_vars; ++i)
 	{
 	  struct per_var_ws *pvw = &ws.vws[i];
@@ -785,34 +792,42 @@ run_oneway (const struct oneway_spec *cmd,
 	    }
 
 	  covariance_accumulate_pass2 (pvw->cov, c);
-	  levene_pass_two (pvw->nl, val->f, w, case_data (c, cmd->indep_var));
+	  if (levene_needs_passes (pvw->nl))
+	    levene_pass_two (pvw->nl, val->f, w,
+			     case_data (c, cmd->indep_var));
 	}
     }
   casereader_destroy (reader);
 
-  reader = casereader_clone (input);
-  for ( ; (c = casereader_read (reader) ); case_unref (c))
+  /* Levene's test needs a third pass for the variables that had too
+     many values for it to keep in memory. */
+  if (need_levene_passes)
     {
-      int i;
-      double w = dict_get_case_weight (dict, c, NULL);
-
-      for (i = 0; i < cmd->n_vars; ++i)
+      reader = casereader_clone (input);
+      for ( ; (c = casereader_read (reader) ); case_unref (c))
 	{
-	  struct per_var_ws *pvw = &ws.vws[i];
-	  const struct variable *v = cmd->vars[i];
-	  const union value *val = case_data (c, v);
+	  int i;
+	  double w = dict_get_case_weight (dict, c, NULL);
 
-	  if ( MISS_ANALYSIS == cmd->missing_type)
+	  for (i = 0; i < cmd->n_vars; ++i)
 	    {
-	      if ( var_is_value_missing (v, val, cmd->exclude))
-		continue;
-	    }
+	      struct per_var_ws *pvw = &ws.vws[i];
+	      const struct variable *v = cmd->vars[i];
+	      const union value *val = case_data (c, v);
 
-	  levene_pass_three (pvw->nl, val->f, w, case_data (c, cmd->indep_var));
+	      if ( MISS_ANALYSIS == cmd->missing_type)
+		{
+		  if ( var_is_value_missing (v, val, cmd->exclude))
+		    continue;
+		}
+
+	      if (levene_needs_passes (pvw->nl))
+		levene_pass_three (pvw->nl, val->f, w,
+				   case_data (c, cmd->indep_var));
+	    }
 	}
+      casereader_destroy (reader);
     }
-  casereader_destroy (reader);
-
 
   for (v = 0; v < cmd->n_vars; ++v)
     {
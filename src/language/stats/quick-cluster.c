@@ -21,6 +21,7 @@
 #include <gsl/gsl_sort_vector.h>
 #include <gsl/gsl_statistics.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -42,6 +43,9 @@
 #include "output/tab.h"
 #include "output/text-item.h"
 
+#include "gl/minmax.h"
+#include "gl/xalloc.h"
+
 #include "gettext.h"
 #define _(msgid) gettext (msgid)
 #define N_(msgid) msgid
@@ -52,6 +56,13 @@ enum missing_type
     MISS_PAIRWISE,
   };
 
+/* How to choose the initial cluster centers. */
+enum qc_initial
+  {
+    QC_INITIAL_DEFAULT,         /* Fixed starting centers. */
+    QC_INITIAL_KMEANSPP,        /* k-means++ seeding from the cases. */
+  };
+
 
 struct qc
 {
@@ -65,6 +76,7 @@ struct qc
 
   enum missing_type missing_type;
   enum mv_class exclude;
+  enum qc_initial initial;
 };
 
 /* Holds all of the information for the functions.  int n, holds the number of
@@ -83,20 +95,47 @@ struct Kmeans
   gsl_matrix *initial_centers;	/* Initial random centers. */
 
   gsl_permutation *group_order;	/* Group order for reporting. */
-  struct caseproto *proto;
-  struct casereader *index_rdr;	/* Group ids for each case. */
+
+  /* The data, read from the input once by kmeans_load. */
+  size_t n_cases;               /* Number of cases. */
+  double *values;               /* n_cases x n_vars, stored case by case. */
+  bool *missing;                /* True if corresponding value is missing. */
+  bool *case_missing;           /* True if any value in case is missing. */
+  double *weights;              /* Weight of each case. */
+
+  int *index;                   /* Group of each case, or -1 if none yet. */
+
+  /* For skipping distance calculations.  These hold, for each case,
+     an upper bound on the distance to the center of its group and a
+     lower bound on the distance to the center of any other group. */
+  double *upper;
+  double *lower;
+  bool bounds_valid;            /* False until bounds are calculated. */
+  gsl_matrix *old_centers;      /* Centers before latest recalculation. */
 };
 
+/* Relative margin by which a bound must show that a case's group is
+   unchanged before the distance calculations are skipped, so that
+   rounding error cannot change which of two nearly equidistant
+   centers is chosen. */
+#define BOUND_MARGIN 1e-9
+
 static struct Kmeans *kmeans_create (const struct qc *qc);
 
+static void kmeans_load (struct Kmeans *, struct casereader *, const struct qc *);
+
 static void kmeans_randomize_centers (struct Kmeans *kmeans, const struct qc *qc);
 
-static int kmeans_get_nearest_group (struct Kmeans *kmeans, struct ccase *c, const struct qc *);
+static bool kmeans_plusplus_centers (struct Kmeans *kmeans, const struct qc *qc);
 
-static void kmeans_recalculate_centers (struct Kmeans *kmeans, const struct casereader *reader, const struct qc *);
+static int kmeans_get_nearest_group (const struct Kmeans *kmeans, size_t row,
+                                     const struct qc *, double *min_dist,
+                                     double *second_dist);
+
+static void kmeans_recalculate_centers (struct Kmeans *kmeans, const struct qc *);
 
 static int
-kmeans_calculate_indexes_and_check_convergence (struct Kmeans *kmeans, const struct casereader *reader, const struct qc *);
+kmeans_calculate_indexes_and_check_convergence (struct Kmeans *kmeans, const struct qc *);
 
 static void kmeans_order_groups (struct Kmeans *kmeans, const struct qc *);
 
@@ -118,18 +157,16 @@ static void kmeans_destroy (struct Kmeans *kmeans);
 static struct Kmeans *
 kmeans_create (const struct qc *qc)
 {
-  struct Kmeans *kmeans = xmalloc (sizeof (struct Kmeans));
+  struct Kmeans *kmeans = xzalloc (sizeof (struct Kmeans));
   kmeans->centers = gsl_matrix_alloc (qc->ngroups, qc->n_vars);
+  kmeans->old_centers = gsl_matrix_alloc (qc->ngroups, qc->n_vars);
   kmeans->num_elements_groups = gsl_vector_long_alloc (qc->ngroups);
   kmeans->n = 0;
   kmeans->lastiter = 0;
   kmeans->trials = 0;
   kmeans->group_order = gsl_permutation_alloc (kmeans->centers->size1);
   kmeans->initial_centers = NULL;
-
-  kmeans->proto = caseproto_create ();
-  kmeans->proto = caseproto_add_width (kmeans->proto, 0);
-  kmeans->index_rdr = NULL;
+  kmeans->bounds_valid = false;
   return (kmeans);
 }
 
@@ -137,19 +174,97 @@ static void
 kmeans_destroy (struct Kmeans *kmeans)
 {
   gsl_matrix_free (kmeans->centers);
+  gsl_matrix_free (kmeans->old_centers);
   gsl_matrix_free (kmeans->initial_centers);
 
   gsl_vector_long_free (kmeans->num_elements_groups);
 
   gsl_permutation_free (kmeans->group_order);
 
-  caseproto_unref (kmeans->proto);
-
-  casereader_destroy (kmeans->index_rdr);
+  free (kmeans->values);
+  free (kmeans->missing);
+  free (kmeans->case_missing);
+  free (kmeans->weights);
+  free (kmeans->index);
+  free (kmeans->upper);
+  free (kmeans->lower);
 
   free (kmeans);
 }
 
+/* Reads the clustered variables and the weights of the cases in
+   READER into KMEANS, so that each iteration works from memory. */
+static void
+kmeans_load (struct Kmeans *kmeans, struct casereader *reader,
+             const struct qc *qc)
+{
+  size_t allocated = 0;
+  struct ccase *c;
+  size_t row;
+
+  kmeans->n_cases = 0;
+  for (reader = casereader_clone (reader);
+       (c = casereader_read (reader)) != NULL; case_unref (c))
+    {
+      double *x;
+      bool *missing;
+      int v;
+
+      row = kmeans->n_cases++;
+      if (row >= allocated)
+        {
+          kmeans->weights = x2nrealloc (kmeans->weights, &allocated,
+                                        sizeof *kmeans->weights);
+          kmeans->case_missing = xnrealloc (kmeans->case_missing, allocated,
+                                            sizeof *kmeans->case_missing);
+          kmeans->values = xnrealloc (kmeans->values, allocated,
+                                      qc->n_vars * sizeof *kmeans->values);
+          kmeans->missing = xnrealloc (kmeans->missing, allocated,
+                                       qc->n_vars * sizeof *kmeans->missing);
+        }
+
+      kmeans->weights[row] = qc->wv ? case_data (c, qc->wv)->f : 1.0;
+      kmeans->case_missing[row] = false;
+      x = &kmeans->values[row * qc->n_vars];
+      missing = &kmeans->missing[row * qc->n_vars];
+      for (v = 0; v < qc->n_vars; ++v)
+        {
+          const union value *val = case_data (c, qc->vars[v]);
+
+          x[v] = val->f;
+          missing[v] = var_is_value_missing (qc->vars[v], val, qc->exclude);
+          if (missing[v])
+            kmeans->case_missing[row] = true;
+        }
+    }
+  casereader_destroy (reader);
+
+  kmeans->index = xnmalloc (MAX (kmeans->n_cases, 1), sizeof *kmeans->index);
+  kmeans->upper = xnmalloc (MAX (kmeans->n_cases, 1), sizeof *kmeans->upper);
+  kmeans->lower = xnmalloc (MAX (kmeans->n_cases, 1), sizeof *kmeans->lower);
+  for (row = 0; row < kmeans->n_cases; row++)
+    kmeans->index[row] = -1;
+}
+
+/* Records that the centers in KMEANS have been set to new starting
+   values. */
+static void
+kmeans_centers_replaced (struct Kmeans *kmeans, const struct qc *qc)
+{
+  /* If it is the first iteration, the variable kmeans->initial_centers is NULL
+     and it is created once for reporting issues. In SPSS, initial centers are
+     shown in the reports but in PSPP it is not shown now. I am leaving it
+     here. */
+  if (!kmeans->initial_centers)
+    {
+      kmeans->initial_centers = gsl_matrix_alloc (qc->ngroups, qc->n_vars);
+      gsl_matrix_memcpy (kmeans->initial_centers, kmeans->centers);
+    }
+
+  /* The centers have been replaced, so any bounds are meaningless. */
+  kmeans->bounds_valid = false;
+}
+
 /* Creates random centers using randomly selected cases from the data. */
 static void
 kmeans_randomize_centers (struct Kmeans *kmeans, const struct qc *qc)
@@ -169,77 +284,161 @@ kmeans_randomize_centers (struct Kmeans *kmeans, const struct qc *qc)
 	    }
 	}
     }
-  /* If it is the first iteration, the variable kmeans->initial_centers is NULL
-     and it is created once for reporting issues. In SPSS, initial centers are
-     shown in the reports but in PSPP it is not shown now. I am leaving it
-     here. */
-  if (!kmeans->initial_centers)
+  kmeans_centers_replaced (kmeans, qc);
+}
+
+/* Returns the squared distance between case ROW in KMEANS and the
+   center of GROUP, ignoring missing values. */
+static double
+kmeans_distance (const struct Kmeans *kmeans, size_t row, int group,
+                 const struct qc *qc)
+{
+  const double *x = &kmeans->values[row * qc->n_vars];
+  const bool *missing = &kmeans->missing[row * qc->n_vars];
+  const double *center = gsl_matrix_const_ptr (kmeans->centers, group, 0);
+  double dist = 0;
+  int j;
+
+  for (j = 0; j < qc->n_vars; j++)
+    if (!missing[j])
+      dist += pow2 (center[j] - x[j]);
+  return dist;
+}
+
+/* Returns a case chosen at random from those in KMEANS that have no
+   missing values, each with probability proportional to its weight
+   times SCORE[row], whose total over those cases is TOTAL.  TOTAL must
+   be positive. */
+static size_t
+kmeans_choose_case (const struct Kmeans *kmeans, const double *score,
+                    double total)
+{
+  double target = gsl_rng_uniform (get_rng ()) * total;
+  size_t chosen = SIZE_MAX;
+  size_t row;
+
+  for (row = 0; row < kmeans->n_cases; row++)
+    if (!kmeans->case_missing[row] && kmeans->weights[row] > 0
+        && score[row] > 0)
+      {
+        chosen = row;
+        target -= kmeans->weights[row] * score[row];
+        if (target < 0)
+          break;
+      }
+  return chosen;
+}
+
+/* Chooses the initial centers in KMEANS from the cases by k-means++
+   seeding: the first center is a case chosen at random, and each
+   later center is a case chosen with probability proportional to the
+   squared distance to the nearest center already chosen.
+
+   Returns false if fewer than QC->ngroups distinct cases have no
+   missing values. */
+static bool
+kmeans_plusplus_centers (struct Kmeans *kmeans, const struct qc *qc)
+{
+  double *dist = xnmalloc (MAX (kmeans->n_cases, 1), sizeof *dist);
+  double total = 0;
+  size_t row;
+  int i;
+
+  for (row = 0; row < kmeans->n_cases; row++)
     {
-      kmeans->initial_centers = gsl_matrix_alloc (qc->ngroups, qc->n_vars);
-      gsl_matrix_memcpy (kmeans->initial_centers, kmeans->centers);
+      dist[row] = 1.0;
+      if (!kmeans->case_missing[row] && kmeans->weights[row] > 0)
+        total += kmeans->weights[row];
     }
+
+  for (i = 0; i < qc->ngroups; i++)
+    {
+      const double *center;
+      size_t chosen;
+      int j;
+
+      if (total <= 0)
+        {
+          free (dist);
+          return false;
+        }
+      chosen = kmeans_choose_case (kmeans, dist, total);
+      center = &kmeans->values[chosen * qc->n_vars];
+      for (j = 0; j < qc->n_vars; j++)
+        gsl_matrix_set (kmeans->centers, i, j, center[j]);
+
+      /* Update each case's squared distance to the nearest center. */
+      total = 0;
+      for (row = 0; row < kmeans->n_cases; row++)
+        if (!kmeans->case_missing[row] && kmeans->weights[row] > 0)
+          {
+            const double *x = &kmeans->values[row * qc->n_vars];
+            double d = 0;
+
+            for (j = 0; j < qc->n_vars; j++)
+              d += pow2 (center[j] - x[j]);
+            if (i == 0 || d < dist[row])
+              dist[row] = d;
+            total += kmeans->weights[row] * dist[row];
+          }
+    }
+  free (dist);
+
+  kmeans_centers_replaced (kmeans, qc);
+  return true;
 }
 
+/* Returns the group whose center is nearest to case ROW in KMEANS.
+   Stores the squared distance to that center in *MIN_DIST and the
+   squared distance to the next nearest in *SECOND_DIST. */
 static int
-kmeans_get_nearest_group (struct Kmeans *kmeans, struct ccase *c, const struct qc *qc)
+kmeans_get_nearest_group (const struct Kmeans *kmeans, size_t row,
+                          const struct qc *qc, double *min_dist,
+                          double *second_dist)
 {
   int result = -1;
-  int i, j;
+  int i;
   double mindist = INFINITY;
+  double second = INFINITY;
   for (i = 0; i < qc->ngroups; i++)
     {
-      double dist = 0;
-      for (j = 0; j < qc->n_vars; j++)
-	{
-	  const union value *val = case_data (c, qc->vars[j]);
-	  if ( var_is_value_missing (qc->vars[j], val, qc->exclude))
-	    continue;
-
-	  dist += pow2 (gsl_matrix_get (kmeans->centers, i, j) - val->f);
-	}
+      double dist = kmeans_distance (kmeans, row, i, qc);
       if (dist < mindist)
 	{
+          second = mindist;
 	  mindist = dist;
 	  result = i;
 	}
+      else if (dist < second)
+        second = dist;
     }
+  *min_dist = mindist;
+  *second_dist = second;
   return (result);
 }
 
 /* Re-calculate the cluster centers. */
 static void
-kmeans_recalculate_centers (struct Kmeans *kmeans, const struct casereader *reader, const struct qc *qc)
+kmeans_recalculate_centers (struct Kmeans *kmeans, const struct qc *qc)
 {
   casenumber i = 0;
   int v, j;
-  struct ccase *c;
-
-  struct casereader *cs = casereader_clone (reader);
-  struct casereader *cs_index = casereader_clone (kmeans->index_rdr);
+  size_t row;
 
+  gsl_matrix_memcpy (kmeans->old_centers, kmeans->centers);
   gsl_matrix_set_all (kmeans->centers, 0.0);
-  for (; (c = casereader_read (cs)) != NULL; case_unref (c))
+  for (row = 0; row < kmeans->n_cases; row++)
     {
-      double weight = qc->wv ? case_data (c, qc->wv)->f : 1.0;
-      struct ccase *c_index = casereader_read (cs_index);
-      int index = case_data_idx (c_index, 0)->f;
-      for (v = 0; v < qc->n_vars; ++v)
-	{
-	  const union value *val = case_data (c, qc->vars[v]);
-	  double x = val->f * weight;
-	  double curval;
-
-	  if ( var_is_value_missing (qc->vars[v], val, qc->exclude))
-	    continue;
+      double weight = kmeans->weights[row];
+      const double *x = &kmeans->values[row * qc->n_vars];
+      const bool *missing = &kmeans->missing[row * qc->n_vars];
+      double *center = gsl_matrix_ptr (kmeans->centers, kmeans->index[row], 0);
 
-	  curval = gsl_matrix_get (kmeans->centers, index, v);
-	  gsl_matrix_set (kmeans->centers, index, v, curval + x);
-	}
+      for (v = 0; v < qc->n_vars; ++v)
+        if (!missing[v])
+          center[v] += x[v] * weight;
       i++;
-      case_unref (c_index);
     }
-  casereader_destroy (cs);
-  casereader_destroy (cs_index);
 
   /* Getting number of cases */
   if (kmeans->n == 0)
@@ -266,44 +465,121 @@ kmeans_recalculate_centers (struct Kmeans *kmeans, const struct casereader *read
     }
 }
 
+/* Updates the bounds in KMEANS for the movement of the centers from
+   KMEANS->old_centers to KMEANS->centers.  Stores into HALF_GAP[i]
+   half the distance from the center of group i to the nearest other
+   center. */
+static void
+kmeans_update_bounds (struct Kmeans *kmeans, const struct qc *qc,
+                      double *half_gap)
+{
+  double *shift = xnmalloc (qc->ngroups, sizeof *shift);
+  double max_shift = 0;
+  size_t row;
+  int i, k, j;
+
+  for (i = 0; i < qc->ngroups; i++)
+    {
+      const double *old = gsl_matrix_const_ptr (kmeans->old_centers, i, 0);
+      const double *new = gsl_matrix_const_ptr (kmeans->centers, i, 0);
+      double dist = 0;
+
+      for (j = 0; j < qc->n_vars; j++)
+        dist += pow2 (new[j] - old[j]);
+      shift[i] = sqrt (dist);
+      if (shift[i] > max_shift)
+        max_shift = shift[i];
+
+      half_gap[i] = INFINITY;
+    }
+
+  for (i = 0; i < qc->ngroups; i++)
+    for (k = i + 1; k < qc->ngroups; k++)
+      {
+        const double *a = gsl_matrix_const_ptr (kmeans->centers, i, 0);
+        const double *b = gsl_matrix_const_ptr (kmeans->centers, k, 0);
+        double dist = 0;
+
+        for (j = 0; j < qc->n_vars; j++)
+          dist += pow2 (a[j] - b[j]);
+        dist = sqrt (dist) / 2;
+        if (dist < half_gap[i])
+          half_gap[i] = dist;
+        if (dist < half_gap[k])
+          half_gap[k] = dist;
+      }
+
+  for (row = 0; row < kmeans->n_cases; row++)
+    {
+      kmeans->upper[row] += shift[kmeans->index[row]];
+      kmeans->lower[row] -= max_shift;
+    }
+
+  free (shift);
+}
+
 /* The variable index in struct Kmeans holds integer values that represents the
    current groups of cases.  index[n]=a shows the nth case is belong to ath
    cluster.  This function calculates these indexes and returns the number of
    different cases of the new and old index variables.  If last two index
-   variables are equal, there is no any enhancement of clustering. */
+   variables are equal, there is no any enhancement of clustering.
+
+   A case with no missing values keeps its group, without calculating
+   the distance to every center, if the bounds show that its group's
+   center is still the nearest one (Hamerly's algorithm). */
 static int
-kmeans_calculate_indexes_and_check_convergence (struct Kmeans *kmeans, const struct casereader *reader, const struct qc *qc)
+kmeans_calculate_indexes_and_check_convergence (struct Kmeans *kmeans, const struct qc *qc)
 {
   int totaldiff = 0;
-  struct ccase *c;
-  struct casereader *cs = casereader_clone (reader);
-
-  /* A casewriter into which we will write the indexes. */
-  struct casewriter *index_wtr = autopaging_writer_create (kmeans->proto);
+  double *half_gap = NULL;
+  size_t row;
 
   gsl_vector_long_set_all (kmeans->num_elements_groups, 0);
 
-  for (; (c = casereader_read (cs)) != NULL; case_unref (c))
+  if (kmeans->bounds_valid)
+    {
+      half_gap = xnmalloc (qc->ngroups, sizeof *half_gap);
+      kmeans_update_bounds (kmeans, qc, half_gap);
+    }
+
+  for (row = 0; row < kmeans->n_cases; row++)
     {
-      /* A case to hold the new index. */
-      struct ccase *index_case_new = case_create (kmeans->proto);
-      int bestindex = kmeans_get_nearest_group (kmeans, c, qc);
-      double weight = qc->wv ? case_data (c, qc->wv)->f : 1.0;
+      double weight = kmeans->weights[row];
+      int bestindex = -1;
+
+      if (half_gap != NULL && !kmeans->case_missing[row])
+        {
+          int group = kmeans->index[row];
+          double bound = MAX (half_gap[group], kmeans->lower[row]);
+
+          bound *= 1.0 - BOUND_MARGIN;
+          if (kmeans->upper[row] < bound)
+            bestindex = group;
+          else
+            {
+              kmeans->upper[row] = sqrt (kmeans_distance (kmeans, row, group,
+                                                          qc));
+              if (kmeans->upper[row] < bound)
+                bestindex = group;
+            }
+        }
+
+      if (bestindex < 0)
+        {
+          double min_dist, second_dist;
+
+          bestindex = kmeans_get_nearest_group (kmeans, row, qc,
+                                                &min_dist, &second_dist);
+          kmeans->upper[row] = sqrt (min_dist);
+          kmeans->lower[row] = sqrt (second_dist);
+        }
+
       assert (bestindex < kmeans->num_elements_groups->size);
       kmeans->num_elements_groups->data[bestindex] += weight;
-      if (kmeans->index_rdr)
+      if (kmeans->index[row] >= 0)
 	{
-	  /* A case from which the old index will be read. */
-	  struct ccase *index_case_old = NULL;
-
-	  /* Read the case from the index casereader. */
-	  index_case_old = casereader_read (kmeans->index_rdr);
-
 	  /* Set totaldiff, using the old_index. */
-	  totaldiff += abs (case_data_idx (index_case_old, 0)->f - bestindex);
-
-	  /* We have no use for the old case anymore, so unref it. */
-	  case_unref (index_case_old);
+	  totaldiff += abs (kmeans->index[row] - bestindex);
 	}
       else
 	{
@@ -311,19 +587,12 @@ kmeans_calculate_indexes_and_check_convergence (struct Kmeans *kmeans, const str
 	  totaldiff += bestindex;
 	}
 
-      /* Set the value of the new inde.x */
-      case_data_rw_idx (index_case_new, 0)->f = bestindex;
-
-      /* and write the new index to the casewriter */
-      casewriter_write (index_wtr, index_case_new);
+      /* Set the value of the new index. */
+      kmeans->index[row] = bestindex;
     }
-  casereader_destroy (cs);
-  /* We have now read through the entire index_rdr, so it's of no use
-     anymore. */
-  casereader_destroy (kmeans->index_rdr);
+  free (half_gap);
 
-  /* Convert the writer into a reader, ready for the next iteration to read */
-  kmeans->index_rdr = casewriter_make_reader (index_wtr);
+  kmeans->bounds_valid = true;
 
   return (totaldiff);
 }
@@ -348,14 +617,17 @@ kmeans_cluster (struct Kmeans *kmeans, struct casereader *reader, const struct q
   bool show_warning1;
 
   show_warning1 = true;
+  kmeans_load (kmeans, reader, qc);
 cluster:
   redo = false;
-  kmeans_randomize_centers (kmeans, qc);
+  if (qc->initial != QC_INITIAL_KMEANSPP
+      || !kmeans_plusplus_centers (kmeans, qc))
+    kmeans_randomize_centers (kmeans, qc);
   for (kmeans->lastiter = 0; kmeans->lastiter < qc->maxiter;
        kmeans->lastiter++)
     {
-      diffs = kmeans_calculate_indexes_and_check_convergence (kmeans, reader, qc);
-      kmeans_recalculate_centers (kmeans, reader, qc);
+      diffs = kmeans_calculate_indexes_and_check_convergence (kmeans, qc);
+      kmeans_recalculate_centers (kmeans, qc);
       if (show_warning1 && qc->ngroups > kmeans->n)
 	{
 	  msg (MW, _("Number of clusters may not be larger than the number "
@@ -499,6 +771,7 @@ cmd_quick_cluster (struct lexer *lexer, struct dataset *ds)
   qc.maxiter = 2;
   qc.missing_type = MISS_LISTWISE;
   qc.exclude = MV_ANY;
+  qc.initial = QC_INITIAL_DEFAULT;
 
   if (!parse_variables_const (lexer, dict, &qc.vars, &qc.n_vars,
 			      PV_NO_DUPLICATE | PV_NUMERIC))
@@ -572,6 +845,22 @@ cmd_quick_cluster (struct lexer *lexer, struct dataset *ds)
 		      lex_force_match (lexer, T_RPAREN);
 		    }
 		}
+	      else if (lex_match_id (lexer, "INITIAL"))
+		{
+		  if (!lex_force_match (lexer, T_LPAREN))
+		    goto error;
+		  if (lex_match_id (lexer, "KMEANSPP"))
+		    qc.initial = QC_INITIAL_KMEANSPP;
+		  else if (lex_match_id (lexer, "DEFAULT"))
+		    qc.initial = QC_INITIAL_DEFAULT;
+		  else
+		    {
+		      lex_error_expecting (lexer, "DEFAULT", "KMEANSPP", NULL);
+		      goto error;
+		    }
+		  if (!lex_force_match (lexer, T_RPAREN))
+		    goto error;
+		}
 	      else
                 goto error;
 	    }
@@ -81,6 +81,7 @@ indep_run (struct tt *tt, const struct variable *gvar,
   struct indep_samples is;
   struct ccase *c;
   struct casereader *r;
+  bool need_levene_passes;
 
   struct pair_stats *ps = xcalloc (tt->n_vars, sizeof *ps);
 
@@ -116,12 +117,17 @@ indep_run (struct tt *tt, const struct variable *gvar,
 	    continue;
 
 	  moments_pass_one (ps[v].mom[grp], val->f, w);
-	  levene_pass_one (ps[v].nl, val->f, w, gv);
+	  levene_accumulate (ps[v].nl, val->f, w, gv);
 	}
     }
   casereader_destroy (r);
 
-  r = casereader_clone (reader);
+  need_levene_passes = false;
+  for (v = 0; v < tt->n_vars; ++v)
+    if (levene_needs_passes (ps[v].nl))
+      need_levene_passes = true;
+
+  r = need_levene_passes ? casereader_clone (reader) : reader;
   for ( ; (c = casereader_read (r) ); case_unref (c))
     {
       double w = dict_get_case_weight (tt->dict, c, NULL);
@@ -139,32 +145,38 @@ indep_run (struct tt *tt, const struct variable *gvar,
 	    continue;
 
 	  moments_pass_two (ps[v].mom[grp], val->f, w);
-	  levene_pass_two (ps[v].nl, val->f, w, gv);
+	  if (levene_needs_passes (ps[v].nl))
+	    levene_pass_two (ps[v].nl, val->f, w, gv);
 	}
     }
   casereader_destroy (r);
 
-  r = reader;
-  for ( ; (c = casereader_read (r) ); case_unref (c))
+  /* Levene's test needs a third pass for the variables that had too
+     many values for it to keep in memory. */
+  if (need_levene_passes)
     {
-      double w = dict_get_case_weight (tt->dict, c, NULL);
+      r = reader;
+      for ( ; (c = casereader_read (r) ); case_unref (c))
+	{
+	  double w = dict_get_case_weight (tt->dict, c, NULL);
 
-      const union value *gv = case_data (c, gvar);
+	  const union value *gv = case_data (c, gvar);
 
-      int grp = which_group (gv, &is);
-      if ( grp < 0)
-	continue;
-
-      for (v = 0; v < tt->n_vars; ++v)
-	{
-	  const union value *val = case_data (c, tt->vars[v]);
-	  if (var_is_value_missing (tt->vars[v], val, tt->exclude))
+	  if (which_group (gv, &is) < 0)
 	    continue;
 
-	  levene_pass_three (ps[v].nl, val->f, w, gv);
+	  for (v = 0; v < tt->n_vars; ++v)
+	    {
+	      const union value *val = case_data (c, tt->vars[v]);
+	      if (var_is_value_missing (tt->vars[v], val, tt->exclude))
+		continue;
+
+	      if (levene_needs_passes (ps[v].nl))
+		levene_pass_three (ps[v].nl, val->f, w, gv);
+	    }
 	}
+      casereader_destroy (r);
     }
-  casereader_destroy (r);
 
 
   for (v = 0; v < tt->n_vars; ++v)
@@ -10,11 +10,15 @@ src_math_libpspp_math_la_LIBADD = \
 src_math_libpspp_math_la_SOURCES = \
 	src/math/chart-geometry.c \
 	src/math/chart-geometry.h \
+	src/math/column-ranks.c \
+	src/math/column-ranks.h \
 	src/math/box-whisker.c src/math/box-whisker.h \
 	src/math/categoricals.h \
 	src/math/categoricals.c \
 	src/math/covariance.c \
 	src/math/covariance.h \
+	src/math/covariate-patterns.c \
+	src/math/covariate-patterns.h \
 	src/math/correlation.c \
 	src/math/correlation.h \
 	src/math/extrema.c src/math/extrema.h \
@@ -27,7 +31,9 @@ src_math_libpspp_math_la_SOURCES = \
 	src/math/np.c src/math/np.h \
 	src/math/order-stats.c src/math/order-stats.h \
 	src/math/percentiles.c src/math/percentiles.h \
+	src/math/quantile-sketch.c src/math/quantile-sketch.h \
 	src/math/random.c src/math/random.h \
+	src/math/resample.c src/math/resample.h \
         src/math/statistic.h \
 	src/math/sort.c src/math/sort.h \
 	src/math/trimmed-mean.c src/math/trimmed-mean.h \
@@ -0,0 +1,249 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include "math/column-ranks.h"
+
+#include <stdlib.h>
+
+#include "data/case.h"
+#include "data/settings.h"
+#include "data/val-type.h"
+#include "data/variable.h"
+#include "libpspp/assertion.h"
+
+#include "gl/xalloc.h"
+
+/* One value in a column, before ranking. */
+struct column_entry
+  {
+    double value;
+    double weight;
+    casenumber row;
+  };
+
+/* A value shared by more than one case in a column. */
+struct column_tie
+  {
+    double value;
+    casenumber n;               /* Number of cases with 'value'. */
+    double weight;              /* Sum of the weights of those cases. */
+  };
+
+/* The ranks of a single variable. */
+struct column
+  {
+    struct column_entry *entries; /* Values, freed after ranking. */
+    size_t n_entries;
+    size_t allocated_entries;
+
+    double *ranks;              /* Indexed by row, SYSMIS if missing. */
+
+    struct column_tie *ties;    /* In ascending order of value. */
+    size_t n_ties;
+    size_t allocated_ties;
+  };
+
+struct column_ranks
+  {
+    struct column *columns;
+    size_t n_columns;
+    casenumber n_rows;
+  };
+
+static int
+compare_column_entries (const void *a_, const void *b_)
+{
+  const struct column_entry *a = a_;
+  const struct column_entry *b = b_;
+
+  if (a->value != b->value)
+    return a->value < b->value ? -1 : 1;
+  return a->row < b->row ? -1 : a->row > b->row;
+}
+
+/* Sorts the entries in COL and assigns ranks to them, in a new array
+   of N_ROWS elements. */
+static void
+rank_column (struct column *col, casenumber n_rows)
+{
+  double cc = 0.0;
+  size_t i, j;
+
+  qsort (col->entries, col->n_entries, sizeof *col->entries,
+         compare_column_entries);
+
+  col->ranks = xnmalloc (n_rows, sizeof *col->ranks);
+  for (i = 0; i < n_rows; i++)
+    col->ranks[i] = SYSMIS;
+
+  for (i = 0; i < col->n_entries; i = j)
+    {
+      double value = col->entries[i].value;
+      double weight = col->entries[i].weight;
+      double mean_rank;
+      size_t k;
+
+      for (j = i + 1; j < col->n_entries && col->entries[j].value == value;
+           j++)
+        weight += col->entries[j].weight;
+
+      mean_rank = cc + (weight + 1) / 2.0;
+      cc += weight;
+      for (k = i; k < j; k++)
+        col->ranks[col->entries[k].row] = mean_rank;
+
+      if (j - i > 1)
+        {
+          struct column_tie *tie;
+
+          if (col->n_ties >= col->allocated_ties)
+            col->ties = x2nrealloc (col->ties, &col->allocated_ties,
+                                    sizeof *col->ties);
+          tie = &col->ties[col->n_ties++];
+          tie->value = value;
+          tie->n = j - i;
+          tie->weight = weight;
+        }
+    }
+
+  free (col->entries);
+  col->entries = NULL;
+}
+
+/* Reads all of the cases from INPUT, which this function destroys,
+   and ranks them within each of the N_VARS numeric variables in VARS.
+   WV is the weight variable, or NULL if cases are not weighted.
+   Values in the class EXCLUDE are left out of the ranking.
+
+   Returns the ranks, or a null pointer if the data are too large to
+   rank in the workspace.  The rows in the result are numbered in the
+   order that the cases were read from INPUT, starting from 0. */
+struct column_ranks *
+column_ranks_create (struct casereader *input,
+                     const struct variable *const *vars, size_t n_vars,
+                     const struct variable *wv, enum mv_class exclude)
+{
+  size_t max_rows = (settings_get_workspace ()
+                     / (n_vars * (sizeof (struct column_entry)
+                                  + sizeof (double))));
+  struct column_ranks *cr;
+  struct ccase *c;
+  size_t i;
+
+  cr = xmalloc (sizeof *cr);
+  cr->columns = xcalloc (n_vars, sizeof *cr->columns);
+  cr->n_columns = n_vars;
+  cr->n_rows = 0;
+
+  for (; (c = casereader_read (input)) != NULL; case_unref (c))
+    {
+      double weight = wv != NULL ? case_num (c, wv) : 1.0;
+
+      if (cr->n_rows >= max_rows)
+        {
+          case_unref (c);
+          casereader_destroy (input);
+          column_ranks_destroy (cr);
+          return NULL;
+        }
+
+      for (i = 0; i < n_vars; i++)
+        {
+          struct column *col = &cr->columns[i];
+          double value = case_num (c, vars[i]);
+          struct column_entry *e;
+
+          if (var_is_num_missing (vars[i], value, exclude))
+            continue;
+
+          if (col->n_entries >= col->allocated_entries)
+            col->entries = x2nrealloc (col->entries, &col->allocated_entries,
+                                       sizeof *col->entries);
+          e = &col->entries[col->n_entries++];
+          e->value = value;
+          e->weight = weight;
+          e->row = cr->n_rows;
+        }
+      cr->n_rows++;
+    }
+  casereader_destroy (input);
+
+  for (i = 0; i < n_vars; i++)
+    rank_column (&cr->columns[i], cr->n_rows);
+
+  return cr;
+}
+
+/* Destroys CR. */
+void
+column_ranks_destroy (struct column_ranks *cr)
+{
+  if (cr != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < cr->n_columns; i++)
+        {
+          struct column *col = &cr->columns[i];
+          free (col->entries);
+          free (col->ranks);
+          free (col->ties);
+        }
+      free (cr->columns);
+      free (cr);
+    }
+}
+
+/* Returns the number of cases that were read to create CR. */
+casenumber
+column_ranks_get_n_rows (const struct column_ranks *cr)
+{
+  return cr->n_rows;
+}
+
+/* Returns the rank of the case in ROW within variable VAR_IDX, or
+   SYSMIS if its value for that variable was excluded. */
+double
+column_ranks_get (const struct column_ranks *cr,
+                  size_t var_idx, casenumber row)
+{
+  assert (var_idx < cr->n_columns);
+  assert (row >= 0 && row < cr->n_rows);
+  return cr->columns[var_idx].ranks[row];
+}
+
+/* Calls CALLBACK once for each value of variable VAR_IDX that more
+   than one case shares, in ascending order of value, passing the
+   value, the number of cases, their total weight, and AUX.
+
+   This is the same as the DISTINCT_CALLBACK for
+   casereader_create_append_rank(), except that it is not called for
+   values that only a single case has, which make no contribution to a
+   tie correction. */
+void
+column_ranks_visit_ties (const struct column_ranks *cr, size_t var_idx,
+                         distinct_func *callback, void *aux)
+{
+  const struct column *col;
+  size_t i;
+
+  assert (var_idx < cr->n_columns);
+  col = &cr->columns[var_idx];
+  for (i = 0; i < col->n_ties; i++)
+    callback (col->ties[i].value, col->ties[i].n, col->ties[i].weight, aux);
+}
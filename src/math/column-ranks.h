@@ -0,0 +1,59 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef MATH_COLUMN_RANKS_H
+#define MATH_COLUMN_RANKS_H 1
+
+/* Ranks of several variables at once.
+
+   Nonparametric tests usually need the rank of every case within each
+   of several variables.  Sorting the whole data set once per variable
+   is expensive, so this module instead reads the data once, copies
+   each variable's values into memory, sorts each of those columns,
+   and records the rank of each case in each column, along with the
+   tied values that a test needs for its tie correction.  Afterward,
+   a client can read the same data again and look up each case's
+   ranks by its position in the data, which is called its "row".
+
+   Ranks are the same as those produced by
+   casereader_create_append_rank(): a case's rank is the mean of the
+   weighted positions of all the cases that have the same value.
+
+   When the data are too large to fit in the workspace,
+   column_ranks_create() returns a null pointer and the client should
+   fall back to sorting the data for each variable. */
+
+#include <stddef.h>
+
+#include "data/casereader.h"
+#include "data/missing-values.h"
+
+struct variable;
+
+struct column_ranks *column_ranks_create (struct casereader *input,
+                                          const struct variable *const *vars,
+                                          size_t n_vars,
+                                          const struct variable *wv,
+                                          enum mv_class exclude);
+void column_ranks_destroy (struct column_ranks *);
+
+casenumber column_ranks_get_n_rows (const struct column_ranks *);
+double column_ranks_get (const struct column_ranks *,
+                         size_t var_idx, casenumber row);
+void column_ranks_visit_ties (const struct column_ranks *, size_t var_idx,
+                              distinct_func *, void *aux);
+
+#endif /* math/column-ranks.h */
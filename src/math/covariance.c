@@ -18,7 +18,9 @@
 
 #include "math/covariance.h"
 
+#include <gsl/gsl_blas.h>
 #include <gsl/gsl_matrix.h>
+#include <string.h>
 
 #include "data/case.h"
 #include "data/variable.h"
@@ -32,6 +34,10 @@
 
 #define n_MOMENTS (MOMENT_VARIANCE + 1)
 
+/* Number of cases that covariance_accumulate buffers before adding
+   them to the moments and cross-products. */
+#define TILE_CASES 128
+
 
 /* Create a new matrix of NEW_SIZE x NEW_SIZE and copy the elements of
    matrix IN into it.  IN must be a square matrix, and in normal usage
@@ -115,6 +121,19 @@ struct covariance
   bool pass_two_first_case_seen;
 
   gsl_matrix *unnormalised;
+
+  /* Cases buffered by covariance_accumulate that have not yet been
+     added to the moments and cross-products.  Each matrix has one
+     row per variable and one column per buffered case. */
+  gsl_matrix *tile_x;           /* Values, or 0 if missing. */
+  gsl_matrix *tile_mask;        /* 1 if value not missing, otherwise 0. */
+  double *tile_w;               /* Weight of each case. */
+  size_t n_tile;                /* Number of buffered cases. */
+  bool tile_has_missing;        /* True if any buffered value is missing. */
+
+  /* Scratch space for flush_tile. */
+  gsl_matrix *tile_scratch;     /* dim x TILE_CASES. */
+  gsl_matrix *tile_product;     /* dim x dim. */
 };
 
 
@@ -125,6 +144,10 @@ struct covariance
    In the absence of missing values, the columns of this matrix will
    be identical.  If missing values are involved, then element (i,j)
    is the moment of the i th variable, when paired with the j th variable.
+
+   For a single pass COV, the moments are complete only after
+   covariance_calculate or covariance_calculate_unnormalized has been
+   called.
  */
 const gsl_matrix *
 covariance_moments (const struct covariance *cov, int m)
@@ -166,6 +189,14 @@ covariance_1pass_create (size_t n_vars, const struct variable *const *vars,
   cov->cm = xcalloc (cov->n_cm, sizeof *cov->cm);
   cov->categoricals = NULL;
 
+  cov->tile_x = gsl_matrix_alloc (n_vars, TILE_CASES);
+  cov->tile_mask = gsl_matrix_alloc (n_vars, TILE_CASES);
+  cov->tile_w = xnmalloc (TILE_CASES, sizeof *cov->tile_w);
+  cov->n_tile = 0;
+  cov->tile_has_missing = false;
+  cov->tile_scratch = gsl_matrix_alloc (n_vars, TILE_CASES);
+  cov->tile_product = gsl_matrix_alloc (n_vars, n_vars);
+
   return cov;
 }
 
@@ -181,7 +212,7 @@ covariance_2pass_create (size_t n_vars, const struct variable *const *vars,
 			 const struct variable *wv, enum mv_class exclude)
 {
   size_t i;
-  struct covariance *cov = xmalloc (sizeof *cov);
+  struct covariance *cov = xzalloc (sizeof *cov);
 
   cov->passes = 2;
   cov->state = 0;
@@ -209,6 +240,54 @@ covariance_2pass_create (size_t n_vars, const struct variable *const *vars,
   return cov;
 }
 
+/* Returns a new covariance that is an independent copy of COV,
+   including all of the data accumulated into COV so far.
+
+   Cloning is useful for splitting the second pass of a two pass
+   covariance: clone the covariance after the first pass has been
+   completed, accumulate a separate part of the data into each clone
+   in the second pass, and then combine them with covariance_merge.
+
+   COV must not have categorical variables. */
+struct covariance *
+covariance_clone (const struct covariance *cov)
+{
+  struct covariance *new = xmemdup (cov, sizeof *cov);
+  size_t i;
+
+  assert (cov->categoricals == NULL);
+
+  new->moments = xmalloc (sizeof *new->moments * n_MOMENTS);
+  for (i = 0; i < n_MOMENTS; ++i)
+    {
+      new->moments[i] = gsl_matrix_alloc (cov->moments[i]->size1,
+                                          cov->moments[i]->size2);
+      gsl_matrix_memcpy (new->moments[i], cov->moments[i]);
+    }
+
+  if (cov->cm != NULL)
+    new->cm = xmemdup (cov->cm, cov->n_cm * sizeof *cov->cm);
+  new->unnormalised = NULL;
+
+  if (cov->passes == 1)
+    {
+      new->tile_x = gsl_matrix_alloc (cov->n_vars, TILE_CASES);
+      new->tile_mask = gsl_matrix_alloc (cov->n_vars, TILE_CASES);
+      new->tile_w = xnmalloc (TILE_CASES, sizeof *new->tile_w);
+      new->tile_scratch = gsl_matrix_alloc (cov->n_vars, TILE_CASES);
+      new->tile_product = gsl_matrix_alloc (cov->n_vars, cov->n_vars);
+      if (cov->n_tile > 0)
+        {
+          gsl_matrix_memcpy (new->tile_x, cov->tile_x);
+          gsl_matrix_memcpy (new->tile_mask, cov->tile_mask);
+          memcpy (new->tile_w, cov->tile_w,
+                  cov->n_tile * sizeof *cov->tile_w);
+        }
+    }
+
+  return new;
+}
+
 /* Return an integer, which can be used to index 
    into COV->cm, to obtain the I, J th element
    of the covariance matrix.  If COV->cm does not
@@ -334,79 +413,90 @@ covariance_accumulate_pass1 (struct covariance *cov, const struct ccase *c)
 }
 
 
-/* Call this function for every case in the data set */
-void
-covariance_accumulate_pass2 (struct covariance *cov, const struct ccase *c)
+/* Finishes the first pass of two pass covariance COV and prepares it
+   for the second pass: determines the dimension of the covariance
+   matrix, allocates the cross-products, and turns the sums accumulated
+   in the first pass into means. */
+static void
+start_pass_two (struct covariance *cov)
 {
-  size_t i, j;
-  const double weight = cov->wv ? case_data (c, cov->wv)->f : 1.0;
+  size_t i, j, m;
 
-  assert (cov->passes == 2);
-  assert (cov->state >= 1);
+  cov->state = 2;
 
-  if (! cov->pass_two_first_case_seen)
-    {
-      size_t m;
-      assert (cov->state == 1);
-      cov->state = 2;
+  if (cov->categoricals)
+    categoricals_done (cov->categoricals);
 
-      if (cov->categoricals)
-      	categoricals_done (cov->categoricals);
+  cov->dim = cov->n_vars;
 
-      cov->dim = cov->n_vars;
-      
-      if (cov->categoricals)
-	cov->dim += categoricals_df_total (cov->categoricals);
+  if (cov->categoricals)
+    cov->dim += categoricals_df_total (cov->categoricals);
 
-      cov->n_cm = (cov->dim * (cov->dim - 1)  ) / 2;
-      cov->cm = xcalloc (cov->n_cm, sizeof *cov->cm);
+  cov->n_cm = (cov->dim * (cov->dim - 1)  ) / 2;
+  cov->cm = xcalloc (cov->n_cm, sizeof *cov->cm);
 
-      /* Grow the moment matrices so that they're large enough to accommodate the
-	 categorical elements */
-      for (i = 0; i < n_MOMENTS; ++i)
-	{
-	  cov->moments[i] = resize_matrix (cov->moments[i], cov->dim);
-	}
+  /* Grow the moment matrices so that they're large enough to accommodate the
+     categorical elements */
+  for (i = 0; i < n_MOMENTS; ++i)
+    {
+      cov->moments[i] = resize_matrix (cov->moments[i], cov->dim);
+    }
 
-      /* Populate the moments matrices with the categorical value elements */
-      for (i = cov->n_vars; i < cov->dim; ++i)
+  /* Populate the moments matrices with the categorical value elements */
+  for (i = cov->n_vars; i < cov->dim; ++i)
+    {
+      for (j = 0 ; j < cov->dim ; ++j) /* FIXME: This is WRONG !!! */
 	{
-	  for (j = 0 ; j < cov->dim ; ++j) /* FIXME: This is WRONG !!! */
-	    {
-	      double w = categoricals_get_weight_by_subscript (cov->categoricals, i - cov->n_vars);
+	  double w = categoricals_get_weight_by_subscript (cov->categoricals, i - cov->n_vars);
 
-	      gsl_matrix_set (cov->moments[MOMENT_NONE], i, j, w);
+	  gsl_matrix_set (cov->moments[MOMENT_NONE], i, j, w);
 
-	      w = categoricals_get_sum_by_subscript (cov->categoricals, i - cov->n_vars);
+	  w = categoricals_get_sum_by_subscript (cov->categoricals, i - cov->n_vars);
 
-	      gsl_matrix_set (cov->moments[MOMENT_MEAN], i, j, w);
-	    }
+	  gsl_matrix_set (cov->moments[MOMENT_MEAN], i, j, w);
 	}
+    }
 
-      /* FIXME: This is WRONG!!  It must be fixed to properly handle missing values.  For
-       now it assumes there are none */
-      for (m = 0 ; m < n_MOMENTS; ++m)
+  /* FIXME: This is WRONG!!  It must be fixed to properly handle missing values.  For
+   now it assumes there are none */
+  for (m = 0 ; m < n_MOMENTS; ++m)
+    {
+      for (i = 0 ; i < cov->dim ; ++i)
 	{
-	  for (i = 0 ; i < cov->dim ; ++i)
+	  double x = gsl_matrix_get (cov->moments[m], i, cov->n_vars -1);
+	  for (j = cov->n_vars; j < cov->dim; ++j)
 	    {
-	      double x = gsl_matrix_get (cov->moments[m], i, cov->n_vars -1);
-	      for (j = cov->n_vars; j < cov->dim; ++j)
-		{
-		  gsl_matrix_set (cov->moments[m], i, j, x);
-		}
+	      gsl_matrix_set (cov->moments[m], i, j, x);
 	    }
 	}
+    }
 
-      /* Divide the means by the number of samples */
-      for (i = 0; i < cov->dim; ++i)
+  /* Divide the means by the number of samples */
+  for (i = 0; i < cov->dim; ++i)
+    {
+      for (j = 0; j < cov->dim; ++j)
 	{
-	  for (j = 0; j < cov->dim; ++j)
-	    {
-	      double *x = gsl_matrix_ptr (cov->moments[MOMENT_MEAN], i, j);
-	      *x /= gsl_matrix_get (cov->moments[MOMENT_NONE], i, j);
- 	    }
+	  double *x = gsl_matrix_ptr (cov->moments[MOMENT_MEAN], i, j);
+	  *x /= gsl_matrix_get (cov->moments[MOMENT_NONE], i, j);
 	}
     }
+}
+
+/* Call this function for every case in the data set */
+void
+covariance_accumulate_pass2 (struct covariance *cov, const struct ccase *c)
+{
+  size_t i, j;
+  const double weight = cov->wv ? case_data (c, cov->wv)->f : 1.0;
+
+  assert (cov->passes == 2);
+  assert (cov->state >= 1);
+
+  if (! cov->pass_two_first_case_seen)
+    {
+      assert (cov->state == 1);
+      start_pass_two (cov);
+    }
 
   for (i = 0 ; i < cov->dim; ++i)
     {
@@ -450,14 +540,128 @@ covariance_accumulate_pass2 (struct covariance *cov, const struct ccase *c)
 }
 
 
+/* Adds the N x N matrix product A * B' to the N x N matrix C, where A
+   and B are N x K, using COV->tile_product as scratch space. */
+static void
+add_product (struct covariance *cov, const gsl_matrix *a, const gsl_matrix *b,
+             gsl_matrix *c)
+{
+  gsl_blas_dgemm (CblasNoTrans, CblasTrans, 1.0, a, b, 0.0, cov->tile_product);
+  gsl_matrix_add (c, cov->tile_product);
+}
+
+/* Adds the lower triangle of the N x N matrix in COV->tile_product,
+   which holds sums of cross-products, to COV->cm. */
+static void
+add_cross_products (struct covariance *cov)
+{
+  size_t i, j;
+
+  for (i = 1; i < cov->dim; ++i)
+    {
+      const double *row = gsl_matrix_const_ptr (cov->tile_product, i, 0);
+      for (j = 0; j < i; ++j)
+        cov->cm[cm_idx (cov, i, j)] += row[j];
+    }
+}
+
+/* Adds the cases buffered in COV's tile to its moments and
+   cross-products, then empties the tile. */
+static void
+flush_tile (struct covariance *cov)
+{
+  const size_t n = cov->n_tile;
+  gsl_matrix_view x, mask, scratch;
+  size_t i, j, k;
+
+  if (n == 0)
+    return;
+
+  x = gsl_matrix_submatrix (cov->tile_x, 0, 0, cov->dim, n);
+  mask = gsl_matrix_submatrix (cov->tile_mask, 0, 0, cov->dim, n);
+  scratch = gsl_matrix_submatrix (cov->tile_scratch, 0, 0, cov->dim, n);
+
+  if (!cov->tile_has_missing)
+    {
+      /* No missing values: the moments for variable I are the same
+         whatever variable it is paired with, so compute them once per
+         variable. */
+      for (i = 0; i < cov->dim; ++i)
+        {
+          const double *xi = gsl_matrix_const_ptr (&x.matrix, i, 0);
+          double *wxi = gsl_matrix_ptr (&scratch.matrix, i, 0);
+          double sums[n_MOMENTS] = { 0, 0, 0 };
+
+          for (k = 0; k < n; ++k)
+            {
+              double w = cov->tile_w[k];
+
+              wxi[k] = w * xi[k];
+              sums[MOMENT_NONE] += w;
+              sums[MOMENT_MEAN] += wxi[k];
+              sums[MOMENT_VARIANCE] += wxi[k] * xi[k];
+            }
+
+          for (k = 0; k < n_MOMENTS; ++k)
+            {
+              double *row = gsl_matrix_ptr (cov->moments[k], i, 0);
+              for (j = 0; j < cov->dim; ++j)
+                row[j] += sums[k];
+            }
+        }
+
+      if (cov->wv == NULL)
+        gsl_blas_dsyrk (CblasLower, CblasNoTrans, 1.0, &x.matrix,
+                        0.0, cov->tile_product);
+      else
+        gsl_blas_dgemm (CblasNoTrans, CblasTrans, 1.0, &scratch.matrix,
+                        &x.matrix, 0.0, cov->tile_product);
+      add_cross_products (cov);
+    }
+  else
+    {
+      /* Pairwise missing values: every sum is over the cases in which
+         both variables are present, so multiply through by MASK. */
+      for (i = 0; i < cov->dim; ++i)
+        {
+          const double *mi = gsl_matrix_const_ptr (&mask.matrix, i, 0);
+          double *wmi = gsl_matrix_ptr (&scratch.matrix, i, 0);
+
+          for (k = 0; k < n; ++k)
+            wmi[k] = cov->tile_w[k] * mi[k];
+        }
+      add_product (cov, &scratch.matrix, &mask.matrix,
+                   cov->moments[MOMENT_NONE]);
+
+      gsl_matrix_mul_elements (&scratch.matrix, &x.matrix);
+      add_product (cov, &scratch.matrix, &mask.matrix,
+                   cov->moments[MOMENT_MEAN]);
+      gsl_blas_dgemm (CblasNoTrans, CblasTrans, 1.0, &scratch.matrix,
+                      &x.matrix, 0.0, cov->tile_product);
+      add_cross_products (cov);
+
+      gsl_matrix_mul_elements (&scratch.matrix, &x.matrix);
+      add_product (cov, &scratch.matrix, &mask.matrix,
+                   cov->moments[MOMENT_VARIANCE]);
+    }
+
+  cov->n_tile = 0;
+  cov->tile_has_missing = false;
+}
+
 /* Call this function for every case in the data set.
    After all cases have been passed, call covariance_calculate
+
+   Cases are buffered into a tile of up to TILE_CASES cases, which is
+   then added to the moments and cross-products all at once by
+   flush_tile.
  */
 void
 covariance_accumulate (struct covariance *cov, const struct ccase *c)
 {
-  size_t i, j, m;
   const double weight = cov->wv ? case_data (c, cov->wv)->f : 1.0;
+  size_t k = cov->n_tile;
+  size_t i;
 
   assert (cov->passes == 1);
 
@@ -467,41 +671,109 @@ covariance_accumulate (struct covariance *cov, const struct ccase *c)
       cov->state = 1;
     }
 
+  cov->tile_w[k] = weight;
   for (i = 0 ; i < cov->dim; ++i)
     {
-      const union value *val1 = case_data (c, cov->vars[i]);
+      double *x = gsl_matrix_ptr (cov->tile_x, i, k);
+      double *mask = gsl_matrix_ptr (cov->tile_mask, i, k);
 
       if ( is_missing (cov, i, c))
-	continue;
+        {
+          *x = 0.0;
+          *mask = 0.0;
+          cov->tile_has_missing = true;
+        }
+      else
+        {
+          *x = case_data (c, cov->vars[i])->f;
+          *mask = 1.0;
+        }
+    }
 
-      for (j = 0 ; j < cov->dim; ++j)
-	{
-	  double pwr = 1.0;
-	  int idx;
-	  const union value *val2 = case_data (c, cov->vars[j]);
+  if (++cov->n_tile >= TILE_CASES)
+    flush_tile (cov);
 
-	  if ( is_missing (cov, j, c))
-	    continue;
+  cov->pass_one_first_case_seen = true;
+}
 
-	  idx = cm_idx (cov, i, j);
-	  if (idx >= 0)
-	    {
-	      cov->cm [idx] += val1->f * val2->f * weight;
-	    }
 
-	  for (m = 0 ; m < n_MOMENTS; ++m)
-	    {
-	      double *x = gsl_matrix_ptr (cov->moments[m], i, j);
+/* Adds the data accumulated in SRC to DST, so that DST afterward
+   contains the results of accumulating the cases given to both.  SRC
+   is not modified, except that data it has buffered may be flushed.
 
-	      *x += pwr * weight;
-	      pwr *= val1->f;
-	    }
-	}
+   DST and SRC must have been created with the same number of passes
+   and the same variables, weight variable, and class of missing
+   values to exclude, and neither may have categorical variables.
+
+   Every moment and cross-product that is accumulated is a weighted
+   sum over cases, so partial results combine by simple addition:
+
+     - Single pass covariances may be merged at any time.
+
+     - Two pass covariances may be merged during the first pass.
+       Both must then be finished with the first pass before either
+       one starts the second pass, so that they center the second
+       pass on the same means.  The usual way to do this is to merge
+       first pass partial results into one covariance, then to clone
+       it with covariance_clone for each part of the second pass.
+
+     - Two pass covariances that have started their second pass
+       from the same first pass results may be merged.  DST may also
+       have finished only the first pass that SRC's second pass
+       started from, in which case DST starts its own second pass
+       first.  If SRC has not yet started its second pass, this has
+       no effect. */
+void
+covariance_merge (struct covariance *dst, struct covariance *src)
+{
+  size_t i;
+
+  assert (dst->passes == src->passes);
+  assert (dst->n_vars == src->n_vars);
+  assert (dst->categoricals == NULL && src->categoricals == NULL);
+
+  if (src->state == 0)
+    return;
+
+  if (dst->passes == 1)
+    {
+      flush_tile (dst);
+      flush_tile (src);
+      for (i = 0; i < n_MOMENTS; ++i)
+        gsl_matrix_add (dst->moments[i], src->moments[i]);
+      for (i = 0; i < dst->n_cm; ++i)
+        dst->cm[i] += src->cm[i];
+
+      dst->state = 1;
+      dst->pass_one_first_case_seen = true;
     }
+  else if (src->state == 1)
+    {
+      assert (dst->state <= 1);
+      gsl_matrix_add (dst->moments[MOMENT_NONE], src->moments[MOMENT_NONE]);
+      gsl_matrix_add (dst->moments[MOMENT_MEAN], src->moments[MOMENT_MEAN]);
 
-  cov->pass_one_first_case_seen = true;
-}
+      dst->state = 1;
+      dst->pass_one_first_case_seen = true;
+    }
+  else
+    {
+      if (dst->state == 1)
+        {
+          start_pass_two (dst);
+          dst->pass_two_first_case_seen = true;
+        }
+      assert (dst->state == 2);
+      assert (dst->n_cm == src->n_cm);
+      gsl_matrix_add (dst->moments[MOMENT_VARIANCE],
+                      src->moments[MOMENT_VARIANCE]);
+      for (i = 0; i < dst->n_cm; ++i)
+        dst->cm[i] += src->cm[i];
+    }
 
+  gsl_matrix_free (dst->unnormalised);
+  dst->unnormalised = NULL;
+}
 
 /* 
    Allocate and return a gsl_matrix containing the covariances of the
@@ -615,6 +887,9 @@ covariance_calculate (struct covariance *cov)
   if ( cov->state <= 0 )
     return NULL;
 
+  if (cov->passes == 1)
+    flush_tile (cov);
+
   switch (cov->passes)
     {
     case 1:
@@ -682,6 +957,9 @@ covariance_calculate_unnormalized (struct covariance *cov)
   if (cov->unnormalised != NULL)
     return cov->unnormalised;
 
+  if (cov->passes == 1)
+    flush_tile (cov);
+
   switch (cov->passes)
     {
     case 1:
@@ -721,6 +999,11 @@ covariance_destroy (struct covariance *cov)
   gsl_matrix_free (cov->unnormalised);
   free (cov->moments);
   free (cov->cm);
+  gsl_matrix_free (cov->tile_x);
+  gsl_matrix_free (cov->tile_mask);
+  free (cov->tile_w);
+  gsl_matrix_free (cov->tile_scratch);
+  gsl_matrix_free (cov->tile_product);
   free (cov);
 }
 
@@ -35,9 +35,12 @@ covariance_2pass_create (size_t n_vars, const struct variable *const *vars,
 			 struct categoricals *cats,
 			 const struct variable *wv, enum mv_class excl);
 
+struct covariance *covariance_clone (const struct covariance *);
+
 void covariance_accumulate (struct covariance *, const struct ccase *);
 void covariance_accumulate_pass1 (struct covariance *, const struct ccase *);
 void covariance_accumulate_pass2 (struct covariance *, const struct ccase *);
+void covariance_merge (struct covariance *dst, struct covariance *src);
 
 gsl_matrix * covariance_calculate (struct covariance *);
 const gsl_matrix * covariance_calculate_unnormalized (struct covariance *);
@@ -0,0 +1,120 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include "math/covariate-patterns.h"
+
+#include <stdlib.h>
+
+#include "libpspp/assertion.h"
+#include "math/interaction.h"
+
+#include "gl/xalloc.h"
+
+/* A set of covariate patterns. */
+struct covariate_patterns
+  {
+    struct interaction *key;    /* Variables whose values form a pattern. */
+
+    struct hmap map;            /* Contains "struct covariate_pattern"s. */
+    struct covariate_pattern **patterns; /* In order first seen. */
+    size_t n_patterns;
+    size_t allocated_patterns;
+  };
+
+/* Creates and returns a new, empty set of covariate patterns.  Two
+   cases have the same pattern if their values for the variables in
+   KEY are equal.  KEY is copied, so the caller retains ownership of
+   it. */
+struct covariate_patterns *
+covariate_patterns_create (const struct interaction *key)
+{
+  struct covariate_patterns *cp = xmalloc (sizeof *cp);
+
+  cp->key = interaction_clone (key);
+  hmap_init (&cp->map);
+  cp->patterns = NULL;
+  cp->n_patterns = 0;
+  cp->allocated_patterns = 0;
+
+  return cp;
+}
+
+/* Destroys CP. */
+void
+covariate_patterns_destroy (struct covariate_patterns *cp)
+{
+  if (cp != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < cp->n_patterns; i++)
+        {
+          case_unref (cp->patterns[i]->c);
+          free (cp->patterns[i]);
+        }
+      free (cp->patterns);
+      hmap_destroy (&cp->map);
+      interaction_destroy (cp->key);
+      free (cp);
+    }
+}
+
+/* Adds case C, with the given WEIGHT, to the pattern in CP that
+   matches it, creating the pattern if this is the first case that
+   has it.
+
+   The caller is responsible for leaving out cases with missing
+   values, if that is required. */
+void
+covariate_patterns_add (struct covariate_patterns *cp,
+                        const struct ccase *c, double weight)
+{
+  unsigned int hash = interaction_case_hash (cp->key, c, 0);
+  struct covariate_pattern *p;
+
+  HMAP_FOR_EACH_WITH_HASH (p, struct covariate_pattern, node, hash, &cp->map)
+    if (interaction_case_equal (cp->key, c, p->c))
+      goto found;
+
+  p = xzalloc (sizeof *p);
+  p->c = case_ref (c);
+  hmap_insert (&cp->map, &p->node, hash);
+  if (cp->n_patterns >= cp->allocated_patterns)
+    cp->patterns = x2nrealloc (cp->patterns, &cp->allocated_patterns,
+                               sizeof *cp->patterns);
+  cp->patterns[cp->n_patterns++] = p;
+
+found:
+  p->n += weight;
+}
+
+/* Returns the number of distinct patterns in CP. */
+size_t
+covariate_patterns_count (const struct covariate_patterns *cp)
+{
+  return cp->n_patterns;
+}
+
+/* Returns pattern IDX in CP, which must be less than
+   covariate_patterns_count(CP). */
+const struct covariate_pattern *
+covariate_patterns_get (const struct covariate_patterns *cp, size_t idx)
+{
+  assert (idx < cp->n_patterns);
+  return cp->patterns[idx];
+}
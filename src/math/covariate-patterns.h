@@ -0,0 +1,59 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef MATH_COVARIATE_PATTERNS_H
+#define MATH_COVARIATE_PATTERNS_H 1
+
+/* Covariate patterns.
+
+   A model whose predictors are all categorical depends on the data
+   only through the distinct combinations of predictor values that
+   occur ("covariate patterns") and, for each of them, the total weight
+   of the cases that have it.  This module reduces a set of cases to
+   those patterns in a single hashed pass, so that a model fitter can
+   then work on a table whose size depends on the number of patterns
+   instead of the number of cases.
+
+   Patterns are numbered from 0 in the order in which they are first
+   seen. */
+
+#include <stddef.h>
+
+#include "data/case.h"
+#include "libpspp/hmap.h"
+
+struct interaction;
+
+/* One covariate pattern. */
+struct covariate_pattern
+  {
+    struct hmap_node node;      /* In struct covariate_patterns's 'map'. */
+    struct ccase *c;            /* First case seen with this pattern. */
+    double n;                   /* Total weight of cases with pattern. */
+  };
+
+struct covariate_patterns *covariate_patterns_create (
+  const struct interaction *key);
+void covariate_patterns_destroy (struct covariate_patterns *);
+
+void covariate_patterns_add (struct covariate_patterns *,
+                             const struct ccase *, double weight);
+
+size_t covariate_patterns_count (const struct covariate_patterns *);
+const struct covariate_pattern *covariate_patterns_get (
+  const struct covariate_patterns *, size_t idx);
+
+#endif /* math/covariate-patterns.h */
@@ -21,9 +21,11 @@
 
 #include "libpspp/misc.h"
 #include "libpspp/hmap.h"
+#include "data/settings.h"
 #include "data/value.h"
 #include "data/val-type.h"
 
+#include <gl/minmax.h>
 #include <gl/xalloc.h>
 #include <assert.h>
 
@@ -37,6 +39,14 @@ struct lev
   double n;
 };
 
+/* A value saved by levene_accumulate, for the later passes. */
+struct lev_case
+{
+  double value;
+  double weight;
+  struct lev *lev;              /* Group of the value. */
+};
+
 typedef unsigned int hash_func (const struct levene *, const union value *v);
 typedef bool cmp_func (const struct levene *, const union value *v0, const union value *v1);
 
@@ -63,6 +73,16 @@ struct levene
   double z_grand_mean;
 
   double denominator;
+
+  /* Values saved by levene_accumulate, in the order accumulated. */
+  struct lev_case *cases;
+  size_t n_cases;
+  size_t allocated_cases;
+
+  /* True if levene_accumulate was given more values than fit in the
+     workspace, so that the caller must make the second and third
+     passes. */
+  bool too_many_cases;
 };
 
 
@@ -133,9 +153,10 @@ levene_create (int indep_width, const union value *cutpoint)
 }
 
 
-/* Data accumulation. First pass */
-void 
-levene_pass_one (struct levene *nl, double value, double weight, const union value *gv)
+/* Adds VALUE, with the given WEIGHT, to the group for GV in the
+   first pass, and returns that group. */
+static struct lev *
+pass_one (struct levene *nl, double value, double weight, const union value *gv)
 {
   struct lev *lev = find_group (nl, gv);
 
@@ -157,14 +178,15 @@ levene_pass_one (struct levene *nl, double value, double weight, const union val
   lev->t_bar += value * weight;
 
   nl->grand_n += weight;
+
+  return lev;
 }
 
-/* Data accumulation. Second pass */
-void 
-levene_pass_two (struct levene *nl, double value, double weight, const union value *gv)
+/* Adds VALUE, with the given WEIGHT, to group LEV in the second
+   pass. */
+static void
+pass_two (struct levene *nl, double value, double weight, struct lev *lev)
 {
-  struct lev *lev = NULL;
-
   if ( nl->pass == 1 )
     {
       struct lev *next;
@@ -179,18 +201,16 @@ levene_pass_two (struct levene *nl, double value, double weight, const union val
     }
   assert (nl->pass == 2);
 
-  lev = find_group (nl, gv);
-
   lev->z_mean += fabs (value - lev->t_bar) * weight;
   nl->z_grand_mean += fabs (value - lev->t_bar) * weight;
 }
 
-/* Data accumulation. Third pass */
-void 
-levene_pass_three (struct levene *nl, double value, double weight, const union value *gv)
+/* Adds VALUE, with the given WEIGHT, to group LEV in the third
+   pass. */
+static void
+pass_three (struct levene *nl, double value, double weight, struct lev *lev)
 {
   double z;
-  struct lev *lev = NULL;
 
   if ( nl->pass == 2 )
     {
@@ -208,12 +228,104 @@ levene_pass_three (struct levene *nl, double value, double weight, const union v
   }
 
   assert (nl->pass == 3);
-  lev = find_group (nl, gv);
 
   z = fabs (value - lev->t_bar);
   nl->denominator += pow2 (z - lev->z_mean) * weight;
 }
 
+/* Data accumulation. First pass */
+void 
+levene_pass_one (struct levene *nl, double value, double weight, const union value *gv)
+{
+  assert (nl->cases == NULL);
+  pass_one (nl, value, weight, gv);
+}
+
+/* Data accumulation. Second pass.
+
+   This may also be called after levene_accumulate, if
+   levene_needs_passes returns true. */
+void 
+levene_pass_two (struct levene *nl, double value, double weight, const union value *gv)
+{
+  assert (nl->cases == NULL);
+  pass_two (nl, value, weight, find_group (nl, gv));
+}
+
+/* Data accumulation. Third pass.
+
+   This may also be called after levene_accumulate, if
+   levene_needs_passes returns true. */
+void 
+levene_pass_three (struct levene *nl, double value, double weight, const union value *gv)
+{
+  assert (nl->cases == NULL);
+  pass_three (nl, value, weight, find_group (nl, gv));
+}
+
+/* Data accumulation in a single pass over the data.
+
+   This is an alternative to calling levene_pass_one, levene_pass_two,
+   and levene_pass_three for every value: it does the work of the
+   first pass and saves VALUE, WEIGHT, and its group in memory, and
+   then levene_calculate makes the other two passes over the saved
+   values.  The result is the same.  Do not mix calls to this function
+   with calls to levene_pass_one.
+
+   The saved values are limited to the size of the workspace.  If there
+   are more values than that, NL discards the ones it has saved, and
+   the caller must then pass all of the values to levene_pass_two and
+   then to levene_pass_three, as if levene_pass_one had been called
+   instead of this function.  Use levene_needs_passes to find out
+   whether this is necessary. */
+void
+levene_accumulate (struct levene *nl, double value, double weight,
+                   const union value *gv)
+{
+  struct lev *lev;
+  struct lev_case *lc;
+
+  assert (nl->pass <= 1);
+
+  lev = pass_one (nl, value, weight, gv);
+  if (nl->too_many_cases)
+    return;
+
+  if (nl->n_cases >= nl->allocated_cases)
+    {
+      size_t max_cases = settings_get_workspace () / sizeof *nl->cases;
+
+      if (nl->n_cases >= max_cases)
+        {
+          free (nl->cases);
+          nl->cases = NULL;
+          nl->n_cases = nl->allocated_cases = 0;
+          nl->too_many_cases = true;
+          return;
+        }
+
+      nl->allocated_cases = MIN (MAX (16, 2 * nl->allocated_cases),
+                                 max_cases);
+      nl->cases = xnrealloc (nl->cases, nl->allocated_cases,
+                             sizeof *nl->cases);
+    }
+  lc = &nl->cases[nl->n_cases++];
+  lc->value = value;
+  lc->weight = weight;
+  lc->lev = lev;
+}
+
+/* Returns true if more values were passed to levene_accumulate than
+   fit in the workspace, so that the caller must pass all of them
+   again to levene_pass_two and then to levene_pass_three before
+   calling levene_calculate.  Returns false if levene_calculate can
+   make those passes itself. */
+bool
+levene_needs_passes (const struct levene *nl)
+{
+  return nl->too_many_cases;
+}
+
 
 /* Return the value of the levene statistic */
 double
@@ -226,15 +338,27 @@ levene_calculate (struct levene *nl)
   double nn = 0.0;
 
   /* The Levene calculation requires three passes.
-     Normally this should have been done prior to calling this function.
+     Normally this should have been done prior to calling this function,
+     or the values saved by levene_accumulate so that the second and third
+     passes can be made here.
      However, in abnormal circumstances (eg. the dataset is empty) there
      will have been no passes.
    */
-  assert (nl->pass == 0 || nl->pass == 3);
+  assert (nl->pass == 0 || nl->pass == 3 || nl->cases != NULL);
 
   if ( nl->pass == 0 )
     return SYSMIS;
 
+  if (nl->cases != NULL && nl->pass == 1)
+    {
+      const struct lev_case *lc;
+
+      for (lc = nl->cases; lc < &nl->cases[nl->n_cases]; lc++)
+        pass_two (nl, lc->value, lc->weight, lc->lev);
+      for (lc = nl->cases; lc < &nl->cases[nl->n_cases]; lc++)
+        pass_three (nl, lc->value, lc->weight, lc->lev);
+    }
+
   nl->denominator *= hmap_count (&nl->hmap) - 1;
 
   HMAP_FOR_EACH_SAFE (l, next, struct lev, node, &nl->hmap)
@@ -261,5 +385,6 @@ levene_destroy (struct levene *nl)
     }
 
   hmap_destroy (&nl->hmap);
+  free (nl->cases);
   free (nl);
 }
@@ -17,6 +17,8 @@
 #if !levene_h
 #define levene_h 1
 
+#include <stdbool.h>
+
 struct nl;
 
 union value;
@@ -27,6 +29,9 @@ void levene_pass_one (struct levene *, double value, double weight, const union
 void levene_pass_two (struct levene *, double value, double weight, const union value *gv);
 void levene_pass_three (struct levene *, double value, double weight, const union value *gv);
 
+void levene_accumulate (struct levene *, double value, double weight, const union value *gv);
+bool levene_needs_passes (const struct levene *);
+
 double levene_calculate (struct levene*);
 
 void levene_destroy (struct levene*);
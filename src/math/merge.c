@@ -23,6 +23,7 @@
 
 #include "data/case.h"
 #include "data/casereader.h"
+#include "data/casereader-provider.h"
 #include "data/casewriter.h"
 #include "data/subcase.h"
 #include "libpspp/array.h"
@@ -48,6 +49,7 @@ struct merge
   };
 
 static void do_merge (struct merge *m);
+static struct casereader *make_merging_reader (struct merge *);
 
 struct merge *
 merge_create (const struct subcase *ordering, const struct caseproto *proto)
@@ -68,7 +70,10 @@ merge_destroy (struct merge *m)
 
       subcase_destroy (&m->ordering);
       for (i = 0; i < m->input_cnt; i++)
-        casereader_destroy (m->inputs[i].reader);
+        {
+          case_unref (m->inputs[i].c);
+          casereader_destroy (m->inputs[i].reader);
+        }
       caseproto_unref (m->proto);
       free (m);
     }
@@ -78,7 +83,9 @@ void
 merge_append (struct merge *m, struct casereader *r)
 {
   r = casereader_rename (r);
-  m->inputs[m->input_cnt++].reader = r;
+  m->inputs[m->input_cnt].reader = r;
+  m->inputs[m->input_cnt].c = NULL;
+  m->input_cnt++;
   if (m->input_cnt >= MAX_MERGE_ORDER)
     do_merge (m);
 }
@@ -89,9 +96,8 @@ merge_make_reader (struct merge *m)
   struct casereader *r;
 
   if (m->input_cnt > 1)
-    do_merge (m);
-
-  if (m->input_cnt == 1)
+    r = make_merging_reader (m);
+  else if (m->input_cnt == 1)
     {
       r = m->inputs[0].reader;
       m->input_cnt = 0;
@@ -124,6 +130,22 @@ read_input_case (struct merge *m, size_t idx)
     }
 }
 
+/* Returns the index of the input in M whose current case is least.
+   On ties, the earliest input wins, which keeps merging stable. */
+static size_t
+min_input (const struct merge *m)
+{
+  size_t min;
+  size_t i;
+
+  min = 0;
+  for (i = 1; i < m->input_cnt; i++)
+    if (subcase_compare_3way (&m->ordering, m->inputs[i].c,
+                              &m->ordering, m->inputs[min].c) < 0)
+      min = i;
+  return min;
+}
+
 static void
 do_merge (struct merge *m)
 {
@@ -142,13 +164,7 @@ do_merge (struct merge *m)
       i++;
   while (m->input_cnt > 0)
     {
-      size_t min;
-
-      min = 0;
-      for (i = 1; i < m->input_cnt; i++)
-        if (subcase_compare_3way (&m->ordering, m->inputs[i].c,
-                                  &m->ordering, m->inputs[min].c) < 0)
-          min = i;
+      size_t min = min_input (m);
 
       casewriter_write (w, m->inputs[min].c);
       read_input_case (m, min);
@@ -156,5 +172,86 @@ do_merge (struct merge *m)
 
   m->input_cnt = 1;
   m->inputs[0].reader = casewriter_make_reader (w);
+  m->inputs[0].c = NULL;
+}
+
+/* Merging casereader.
+
+   The final merge of a sort does not need to be written to a
+   temporary file and read back: its inputs can be merged as the
+   sorted output is read.  This saves a full write and read of the
+   data, and lets the first sorted case be read as soon as the runs
+   have been written. */
+
+static const struct casereader_class merge_casereader_class;
+
+/* Transfers the inputs in M, of which there must be at least two, to
+   a new casereader that merges them as it is read, and returns the
+   new casereader. */
+static struct casereader *
+make_merging_reader (struct merge *m)
+{
+  struct merge *mr = merge_create (&m->ordering, m->proto);
+  casenumber case_cnt = 0;
+  struct casereader *r;
+  size_t i;
+
+  assert (m->input_cnt > 1);
+
+  for (i = 0; i < m->input_cnt; i++)
+    {
+      casenumber n = casereader_get_case_cnt (m->inputs[i].reader);
+
+      mr->inputs[i] = m->inputs[i];
+      case_cnt = (case_cnt == CASENUMBER_MAX || n == CASENUMBER_MAX
+                  ? CASENUMBER_MAX
+                  : case_cnt + n);
+    }
+  mr->input_cnt = m->input_cnt;
+  m->input_cnt = 0;
+
+  r = casereader_create_sequential (NULL, mr->proto, case_cnt,
+                                    &merge_casereader_class, mr);
+  for (i = 0; i < mr->input_cnt; i++)
+    taint_propagate (casereader_get_taint (mr->inputs[i].reader),
+                     casereader_get_taint (r));
+
+  for (i = 0; i < mr->input_cnt; )
+    if (read_input_case (mr, i))
+      i++;
+
+  return r;
+}
+
+static struct ccase *
+merge_casereader_read (struct casereader *reader UNUSED, void *m_)
+{
+  struct merge *m = m_;
+  struct ccase *c;
+  size_t min;
+
+  if (m->input_cnt == 0)
+    return NULL;
+
+  min = min_input (m);
+  c = m->inputs[min].c;
+  read_input_case (m, min);
+  return c;
+}
+
+static void
+merge_casereader_destroy (struct casereader *reader UNUSED, void *m_)
+{
+  struct merge *m = m_;
+  merge_destroy (m);
 }
 
+static const struct casereader_class merge_casereader_class =
+  {
+    merge_casereader_read,
+    merge_casereader_destroy,
+    NULL,
+    NULL,
+    NULL,
+  };
+
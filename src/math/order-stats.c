@@ -170,3 +170,149 @@ order_stats_accumulate (struct order_stats **os, size_t nos,
                               var_get_case_index (var));
 }
 
+
+/* Selection. */
+
+static void
+swap_values (struct weighted_value *a, struct weighted_value *b)
+{
+  struct weighted_value tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+/* Returns the median of the first, middle, and last values in
+   VALUES[LO] through VALUES[HI - 1]. */
+static double
+choose_pivot (const struct weighted_value *values, size_t lo, size_t hi)
+{
+  double a = values[lo].value;
+  double b = values[lo + (hi - lo) / 2].value;
+  double c = values[hi - 1].value;
+
+  if (a < b)
+    return b < c ? b : a < c ? c : a;
+  else
+    return a < c ? a : b < c ? c : b;
+}
+
+/* Finds the largest value among VALUES[0] through VALUES[N - 1],
+   which must be nonempty, and updates K as if it were the
+   last value in sorted order before the one with cumulative weight
+   CC. */
+static void
+select_k_lower (struct k *k, const struct weighted_value *values, size_t n,
+                double cc)
+{
+  double y = values[0].value;
+  double c = 0.0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    if (values[i].value > y)
+      {
+        y = values[i].value;
+        c = values[i].weight;
+      }
+    else if (values[i].value == y)
+      c += values[i].weight;
+
+  update_k_lower (k, y, c, cc);
+}
+
+/* Updates K with the two distinct values that bracket its target
+   cumulative weight in VALUES, without sorting them.  This is a
+   weighted quickselect: it partitions VALUES around a pivot and
+   continues only into the part that contains the target, reordering
+   VALUES in the process. */
+static void
+select_k (struct k *k, struct weighted_value *values, size_t n_values)
+{
+  size_t lo = 0;
+  size_t hi = n_values;
+  double below = 0.0;           /* Weight of VALUES[0] through VALUES[LO - 1]. */
+
+  while (lo < hi)
+    {
+      double pivot = choose_pivot (values, lo, hi);
+      double w_less = 0.0;
+      double w_equal = 0.0;
+      size_t lt = lo;
+      size_t gt = hi;
+      size_t i = lo;
+
+      /* Partition into values less than, equal to, and greater than
+         PIVOT. */
+      while (i < gt)
+        {
+          if (values[i].value < pivot)
+            {
+              w_less += values[i].weight;
+              swap_values (&values[lt++], &values[i++]);
+            }
+          else if (values[i].value > pivot)
+            swap_values (&values[i], &values[--gt]);
+          else
+            w_equal += values[i++].weight;
+        }
+
+      if (below + w_less > k->tc)
+        hi = lt;
+      else if (below + w_less + w_equal > k->tc)
+        {
+          if (lt > 0)
+            select_k_lower (k, values, lt, below + w_less);
+          update_k_upper (k, pivot, w_equal, below + w_less + w_equal);
+          return;
+        }
+      else
+        {
+          below += w_less + w_equal;
+          lo = gt;
+        }
+    }
+
+  /* Every value's cumulative weight is at most the target. */
+  select_k_lower (k, values, n_values, below);
+}
+
+/* Calculates the NOS order statistics in OS from the N_VALUES values
+   and weights in VALUES, which need not be sorted and must not
+   include missing values.  The elements of VALUES are reordered.
+
+   This gives the same results as order_stats_accumulate(), in
+   expected time linear in N_VALUES for each order statistic, instead
+   of requiring the values to be sorted.  It only supports order
+   statistics that do not need to see every value, such as
+   percentiles. */
+void
+order_stats_select (struct order_stats **os, size_t nos,
+                    struct weighted_value *values, size_t n_values)
+{
+  double cc = 0.0;
+  size_t i;
+  int j;
+
+  for (i = 0; i < n_values; i++)
+    cc += values[i].weight;
+
+  for (i = 0; i < nos; i++)
+    {
+      struct order_stats *tos = os[i];
+
+      assert (tos->parent.accumulate == NULL);
+      for (j = 0; j < tos->n_k; j++)
+        {
+          struct k *myk = &tos->k[j];
+          if (n_values > 0)
+            select_k (myk, values, n_values);
+          else
+            {
+              /* Match order_stats_accumulate() for an empty reader. */
+              update_k_lower (myk, -DBL_MAX, 0, 0);
+              update_k_upper (myk, -DBL_MAX, 0, 0);
+            }
+        }
+      tos->cc = cc;
+    }
+}
@@ -48,6 +48,13 @@ struct order_stats
   double cc;
 };
 
+/* A value and its weight, for order_stats_select(). */
+struct weighted_value
+{
+  double value;
+  double weight;
+};
+
 enum mv_class;
 
 void order_stats_dump (const struct order_stats *os);
@@ -65,4 +72,7 @@ void order_stats_accumulate (struct order_stats **ptl, size_t nos,
 			     const struct variable *var,
 			     enum mv_class exclude);
 
+void order_stats_select (struct order_stats **os, size_t nos,
+                         struct weighted_value *values, size_t n_values);
+
 #endif
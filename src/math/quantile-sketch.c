@@ -0,0 +1,266 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include "math/quantile-sketch.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "data/val-type.h"
+#include "libpspp/assertion.h"
+
+#include "gl/xalloc.h"
+
+/* A cluster of values, represented by their mean and total weight. */
+struct centroid
+  {
+    double mean;
+    double weight;
+  };
+
+struct quantile_sketch
+  {
+    double compression;         /* Accuracy parameter. */
+
+    /* The first 'n_merged' elements of 'centroids' are sorted by mean
+       and satisfy the t-digest size bound.  The rest, up to 'n', are
+       values added since the last call to compress(). */
+    struct centroid *centroids;
+    size_t n_merged;
+    size_t n;
+    size_t allocated;
+
+    double weight;              /* Total weight of all the values. */
+    double min, max;            /* Smallest and largest value. */
+  };
+
+/* Creates and returns a new, empty quantile sketch.  Larger values of
+   COMPRESSION make the sketch more accurate, at the cost of more
+   memory and time.  QUANTILE_SKETCH_DEFAULT_COMPRESSION is a
+   reasonable choice. */
+struct quantile_sketch *
+quantile_sketch_create (double compression)
+{
+  struct quantile_sketch *qs = xmalloc (sizeof *qs);
+
+  assert (compression >= 10);
+
+  qs->compression = compression;
+  qs->allocated = 5 * (size_t) compression + 16;
+  qs->centroids = xnmalloc (qs->allocated, sizeof *qs->centroids);
+  quantile_sketch_clear (qs);
+
+  return qs;
+}
+
+/* Destroys QS. */
+void
+quantile_sketch_destroy (struct quantile_sketch *qs)
+{
+  if (qs != NULL)
+    {
+      free (qs->centroids);
+      free (qs);
+    }
+}
+
+/* Removes all of the values from QS. */
+void
+quantile_sketch_clear (struct quantile_sketch *qs)
+{
+  qs->n_merged = qs->n = 0;
+  qs->weight = 0.0;
+  qs->min = DBL_MAX;
+  qs->max = -DBL_MAX;
+}
+
+/* The t-digest scale function "k_1", which maps a quantile Q to an
+   index K in [-COMPRESSION/4, COMPRESSION/4], and its inverse.  A
+   centroid may span at most one unit of K, which keeps centroids
+   small near the tails. */
+static double
+q_to_k (double q, double compression)
+{
+  return compression / (2.0 * M_PI) * asin (2.0 * q - 1.0);
+}
+
+static double
+k_to_q (double k, double compression)
+{
+  return k >= compression / 4.0 ? 1.0 : (sin (k * 2.0 * M_PI / compression)
+                                         + 1.0) / 2.0;
+}
+
+/* Returns the largest cumulative weight that a centroid whose
+   cumulative weight starts at WEIGHT_SO_FAR may reach. */
+static double
+weight_limit (const struct quantile_sketch *qs, double weight_so_far)
+{
+  double k = q_to_k (weight_so_far / qs->weight, qs->compression);
+  return k_to_q (k + 1.0, qs->compression) * qs->weight;
+}
+
+static int
+compare_centroids (const void *a_, const void *b_)
+{
+  const struct centroid *a = a_;
+  const struct centroid *b = b_;
+
+  return a->mean < b->mean ? -1 : a->mean > b->mean;
+}
+
+/* Merges the values added to QS since the last call into its sorted
+   centroids. */
+static void
+compress (struct quantile_sketch *qs)
+{
+  struct centroid *c = qs->centroids;
+  double weight_so_far, limit;
+  size_t i, out;
+
+  if (qs->n == qs->n_merged)
+    return;
+
+  qsort (c, qs->n, sizeof *c, compare_centroids);
+
+  out = 0;
+  weight_so_far = 0.0;
+  limit = weight_limit (qs, weight_so_far);
+  for (i = 1; i < qs->n; i++)
+    {
+      double proposed = c[out].weight + c[i].weight;
+      if (weight_so_far + proposed <= limit)
+        {
+          c[out].mean += (c[i].mean - c[out].mean) * c[i].weight / proposed;
+          c[out].weight = proposed;
+        }
+      else
+        {
+          weight_so_far += c[out].weight;
+          limit = weight_limit (qs, weight_so_far);
+          c[++out] = c[i];
+        }
+    }
+  qs->n_merged = qs->n = out + 1;
+}
+
+/* Adds VALUE, with the given WEIGHT, to QS.  Values with nonpositive
+   weight are ignored.  VALUE must not be SYSMIS. */
+void
+quantile_sketch_add (struct quantile_sketch *qs, double value, double weight)
+{
+  struct centroid *c;
+
+  if (weight <= 0.0)
+    return;
+
+  if (qs->n >= qs->allocated)
+    {
+      compress (qs);
+      if (qs->n > qs->allocated / 2)
+        qs->centroids = x2nrealloc (qs->centroids, &qs->allocated,
+                                    sizeof *qs->centroids);
+    }
+
+  c = &qs->centroids[qs->n++];
+  c->mean = value;
+  c->weight = weight;
+
+  qs->weight += weight;
+  if (value < qs->min)
+    qs->min = value;
+  if (value > qs->max)
+    qs->max = value;
+}
+
+/* Adds all of the values summarized by SRC to DST.  SRC is not
+   modified. */
+void
+quantile_sketch_merge (struct quantile_sketch *dst,
+                       const struct quantile_sketch *src)
+{
+  size_t i;
+
+  for (i = 0; i < src->n; i++)
+    quantile_sketch_add (dst, src->centroids[i].mean,
+                         src->centroids[i].weight);
+
+  if (src->min < dst->min)
+    dst->min = src->min;
+  if (src->max > dst->max)
+    dst->max = src->max;
+}
+
+/* Returns the total weight of the values added to QS. */
+double
+quantile_sketch_get_weight (const struct quantile_sketch *qs)
+{
+  return qs->weight;
+}
+
+/* Returns an estimate of the quantile P, which must be between 0 and
+   1, of the values in QS, or SYSMIS if QS is empty.
+
+   Each centroid is treated as if its weight were spread evenly
+   around its mean, and the estimate is linearly interpolated between
+   the two centroids nearest P.  In the outermost half of the first
+   and last centroid, it is interpolated toward the minimum or
+   maximum value instead. */
+double
+quantile_sketch_quantile (struct quantile_sketch *qs, double p)
+{
+  const struct centroid *c;
+  double index, weight_so_far;
+  size_t n, i;
+
+  assert (p >= 0.0 && p <= 1.0);
+
+  if (qs->weight <= 0.0)
+    return SYSMIS;
+  else if (p == 0.0)
+    return qs->min;
+  else if (p == 1.0)
+    return qs->max;
+
+  compress (qs);
+  c = qs->centroids;
+  n = qs->n;
+  if (n == 1)
+    return c[0].mean;
+
+  index = p * qs->weight;
+  if (index < c[0].weight / 2.0)
+    return qs->min + (c[0].mean - qs->min) * index / (c[0].weight / 2.0);
+  else if (index > qs->weight - c[n - 1].weight / 2.0)
+    return qs->max - ((qs->max - c[n - 1].mean) * (qs->weight - index)
+                      / (c[n - 1].weight / 2.0));
+
+  weight_so_far = c[0].weight / 2.0;
+  for (i = 0; i + 1 < n; i++)
+    {
+      double dw = (c[i].weight + c[i + 1].weight) / 2.0;
+      if (weight_so_far + dw > index)
+        {
+          double t = (index - weight_so_far) / dw;
+          return c[i].mean + t * (c[i + 1].mean - c[i].mean);
+        }
+      weight_so_far += dw;
+    }
+  return c[n - 1].mean;
+}
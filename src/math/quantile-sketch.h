@@ -0,0 +1,62 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef MATH_QUANTILE_SKETCH_H
+#define MATH_QUANTILE_SKETCH_H 1
+
+/* Streaming approximate quantiles.
+
+   A quantile sketch summarizes a stream of weighted values in a
+   bounded amount of memory, without sorting them, and can then
+   estimate any quantile of the values seen so far.  This is useful
+   for data sets too large to sort cheaply, when an approximate answer
+   is acceptable.
+
+   The implementation is a "merging t-digest" (Dunning and Ertl,
+   "Computing Extremely Accurate Quantiles Using t-Digests").  Values
+   are clustered into weighted centroids, with small centroids near
+   the tails and larger ones near the median, so that the error in
+   the rank of an estimated quantile is roughly proportional to
+   sqrt(q(1-q))/COMPRESSION.  Memory use is proportional to COMPRESSION and
+   independent of the number of values.  While fewer than about
+   COMPRESSION/2 values have been added, every value is kept in its
+   own centroid, so that estimates only interpolate between adjacent
+   values; in particular, the median of unweighted data is then
+   exact.
+
+   Two sketches that summarize different parts of a data set may be
+   merged with quantile_sketch_merge(), so that parts of a data set
+   may be summarized independently and then combined. */
+
+#include <stddef.h>
+
+/* A reasonable default value for the COMPRESSION argument to
+   quantile_sketch_create(). */
+#define QUANTILE_SKETCH_DEFAULT_COMPRESSION 100
+
+struct quantile_sketch *quantile_sketch_create (double compression);
+void quantile_sketch_destroy (struct quantile_sketch *);
+void quantile_sketch_clear (struct quantile_sketch *);
+
+void quantile_sketch_add (struct quantile_sketch *,
+                          double value, double weight);
+void quantile_sketch_merge (struct quantile_sketch *dst,
+                            const struct quantile_sketch *src);
+
+double quantile_sketch_get_weight (const struct quantile_sketch *);
+double quantile_sketch_quantile (struct quantile_sketch *, double p);
+
+#endif /* math/quantile-sketch.h */
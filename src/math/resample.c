@@ -0,0 +1,205 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <config.h>
+
+#include "math/resample.h"
+
+#include <gsl/gsl_randist.h>
+#include <gsl/gsl_rng.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "data/case.h"
+#include "data/casereader.h"
+#include "data/variable.h"
+#include "libpspp/assertion.h"
+
+#include "gl/minmax.h"
+#include "gl/xalloc.h"
+
+struct resample
+  {
+    double **columns;           /* One array of values per variable. */
+    size_t n_vars;
+    double *weights;            /* Case weights, one per row. */
+    size_t n_rows;
+
+    /* Number of cases in each replicate: the number of rows if the
+       data are unweighted, otherwise the total weight, rounded. */
+    size_t n_draws;
+
+    /* For weighted data, a table for drawing rows with probability
+       proportional to their weights; otherwise null. */
+    gsl_ran_discrete_t *table;
+  };
+
+/* Reads all of the cases in INPUT, which this function destroys, and
+   keeps the values of the N_VARS numeric variables in VARS for
+   resampling.  WV is the weight variable, or NULL if the data are not
+   weighted.
+
+   The caller should filter out cases with missing values, if
+   necessary, and cases with invalid weights. */
+struct resample *
+resample_create (struct casereader *input,
+                 const struct variable *const *vars, size_t n_vars,
+                 const struct variable *wv)
+{
+  struct resample *rs = xmalloc (sizeof *rs);
+  size_t allocated_rows = 0;
+  double total_weight = 0.0;
+  struct ccase *c;
+  size_t i;
+
+  rs->columns = xcalloc (n_vars, sizeof *rs->columns);
+  rs->n_vars = n_vars;
+  rs->weights = NULL;
+  rs->n_rows = 0;
+
+  for (; (c = casereader_read (input)) != NULL; case_unref (c))
+    {
+      if (rs->n_rows >= allocated_rows)
+        {
+          size_t n = allocated_rows;
+
+          rs->weights = x2nrealloc (rs->weights, &n, sizeof *rs->weights);
+          for (i = 0; i < n_vars; i++)
+            rs->columns[i] = xnrealloc (rs->columns[i], n,
+                                        sizeof *rs->columns[i]);
+          allocated_rows = n;
+        }
+
+      for (i = 0; i < n_vars; i++)
+        rs->columns[i][rs->n_rows] = case_num (c, vars[i]);
+      rs->weights[rs->n_rows] = wv != NULL ? case_num (c, wv) : 1.0;
+      total_weight += rs->weights[rs->n_rows];
+      rs->n_rows++;
+    }
+  casereader_destroy (input);
+
+  if (wv != NULL && rs->n_rows > 0)
+    {
+      /* Draw at least one case, so that every replicate has data. */
+      rs->n_draws = MAX (1, floor (total_weight + 0.5));
+      rs->table = gsl_ran_discrete_preproc (rs->n_rows, rs->weights);
+    }
+  else
+    {
+      rs->n_draws = rs->n_rows;
+      rs->table = NULL;
+    }
+
+  return rs;
+}
+
+/* Destroys RS. */
+void
+resample_destroy (struct resample *rs)
+{
+  if (rs != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < rs->n_vars; i++)
+        free (rs->columns[i]);
+      free (rs->columns);
+      free (rs->weights);
+      if (rs->table != NULL)
+        gsl_ran_discrete_free (rs->table);
+      free (rs);
+    }
+}
+
+/* Returns the number of rows (cases) in RS. */
+size_t
+resample_get_n_rows (const struct resample *rs)
+{
+  return rs->n_rows;
+}
+
+/* Returns the values of variable VAR_IDX in RS, one per row. */
+const double *
+resample_get_column (const struct resample *rs, size_t var_idx)
+{
+  assert (var_idx < rs->n_vars);
+  return rs->columns[var_idx];
+}
+
+/* Returns the case weights in RS, one per row. */
+const double *
+resample_get_weights (const struct resample *rs)
+{
+  return rs->weights;
+}
+
+/* Seeds RNG for bootstrap replicate REPLICATE, given base SEED. */
+static void
+seed_replicate (gsl_rng *rng, unsigned long int seed, size_t replicate)
+{
+  gsl_rng_set (rng, seed + replicate);
+}
+
+/* Draws a bootstrap replicate from RS using RNG, storing in FREQS[i]
+   the number of times that row i was drawn. */
+static void
+draw (const struct resample *rs, gsl_rng *rng, double *freqs)
+{
+  size_t i;
+
+  for (i = 0; i < rs->n_rows; i++)
+    freqs[i] = 0.0;
+
+  if (rs->n_rows == 0)
+    return;
+
+  for (i = 0; i < rs->n_draws; i++)
+    {
+      size_t row = (rs->table != NULL
+                    ? gsl_ran_discrete (rng, rs->table)
+                    : gsl_rng_uniform_int (rng, rs->n_rows));
+      freqs[row] += 1.0;
+    }
+}
+
+/* Draws N_REPLICATES bootstrap replicates from RS, numbered starting
+   from 0, using base SEED, and calls STAT with AUX for each of them.
+   STAT's N_RESULTS results for replicate i are stored starting at
+   RESULTS[i * N_RESULTS].
+
+   For unweighted data, each replicate draws as many rows as RS has,
+   each with equal probability.  For weighted data, each replicate
+   draws as many rows as the total weight, rounded to the nearest
+   integer, with probability proportional to their weights. */
+void
+resample_run (const struct resample *rs, unsigned long int seed,
+              size_t n_replicates, resample_stat_func *stat, void *aux,
+              size_t n_results, double *results)
+{
+  gsl_rng *rng = gsl_rng_alloc (gsl_rng_mt19937);
+  double *freqs = xnmalloc (rs->n_rows + 1, sizeof *freqs);
+  size_t i;
+
+  for (i = 0; i < n_replicates; i++)
+    {
+      seed_replicate (rng, seed, i);
+      draw (rs, rng, freqs);
+      stat (rs, freqs, &results[i * n_results], aux);
+    }
+
+  free (freqs);
+  gsl_rng_free (rng);
+}
@@ -0,0 +1,63 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef MATH_RESAMPLE_H
+#define MATH_RESAMPLE_H 1
+
+/* Bootstrap resampling.
+
+   A "struct resample" holds the values of a few numeric variables for
+   every case in a data set, loaded into memory once.  Each bootstrap
+   replicate draws a sample of cases, with replacement, from those
+   cases and represents it as a "frequency" for each case, that is,
+   the number of times that the case was drawn.  A statistic computes
+   its value for a replicate by weighting each case by its frequency,
+   so that no data needs to be copied or read again.
+
+   Each replicate draws from its own random number stream, seeded from
+   a base seed and the replicate's number, so the frequencies for a
+   given replicate do not depend on which other replicates are drawn
+   or in which order. */
+
+#include <stddef.h>
+
+struct casereader;
+struct resample;
+struct variable;
+
+struct resample *resample_create (struct casereader *,
+                                  const struct variable *const *vars,
+                                  size_t n_vars,
+                                  const struct variable *wv);
+void resample_destroy (struct resample *);
+
+size_t resample_get_n_rows (const struct resample *);
+const double *resample_get_column (const struct resample *, size_t var_idx);
+const double *resample_get_weights (const struct resample *);
+
+/* Computes N_RESULTS statistics, storing them into RESULTS, for the
+   data in RS with each row weighted by the corresponding element of
+   WEIGHTS. */
+typedef void resample_stat_func (const struct resample *rs,
+                                 const double *weights,
+                                 double *results, void *aux);
+
+void resample_run (const struct resample *, unsigned long int seed,
+                   size_t n_replicates,
+                   resample_stat_func *, void *aux,
+                   size_t n_results, double *results);
+
+#endif /* math/resample.h */
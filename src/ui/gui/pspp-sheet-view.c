@@ -3807,6 +3807,8 @@ pspp_sheet_view_bin_expose (GtkWidget      *widget,
   GtkTreeIter iter;
   gint new_y;
   gint y_offset, cell_offset;
+  GList *start_column;
+  gint start_offset;
   gint max_height;
   GdkRectangle background_area;
   GdkRectangle cell_area;
@@ -3928,6 +3930,25 @@ pspp_sheet_view_bin_expose (GtkWidget      *widget,
        first_column = first_column->next)
     ;
 
+  /* Find the first column that intersects the exposed area, so that
+   * each row can start drawing there instead of walking past every
+   * column to its left.  With thousands of columns this walk would
+   * otherwise be repeated for every visible row.
+   */
+  start_offset = 0;
+  for (start_column = (rtl ? g_list_last (tree_view->priv->columns) : g_list_first (tree_view->priv->columns));
+       start_column;
+       start_column = (rtl ? start_column->prev : start_column->next))
+    {
+      PsppSheetViewColumn *column = start_column->data;
+
+      if (!column->visible)
+        continue;
+      if (start_offset + column->width >= event->area.x)
+        break;
+      start_offset += column->width;
+    }
+
   /* Actually process the expose event.  To do this, we want to
    * start at the first node of the event, and walk the tree in
    * order, drawing each successive node.
@@ -3944,7 +3965,7 @@ pspp_sheet_view_bin_expose (GtkWidget      *widget,
 
       max_height = ROW_HEIGHT (tree_view);
 
-      cell_offset = 0;
+      cell_offset = start_offset;
 
       background_area.y = y_offset + event->area.y;
       background_area.height = max_height;
@@ -3980,7 +4001,7 @@ pspp_sheet_view_bin_expose (GtkWidget      *widget,
       else
         has_special_cell = tree_view->priv->special_cells == PSPP_SHEET_VIEW_SPECIAL_CELLS_YES;
 
-      for (list = (rtl ? g_list_last (tree_view->priv->columns) : g_list_first (tree_view->priv->columns));
+      for (list = start_column;
 	   list;
 	   list = (rtl ? list->prev : list->next))
 	{
@@ -3992,6 +4013,11 @@ pspp_sheet_view_bin_expose (GtkWidget      *widget,
 	  if (!column->visible)
             continue;
 
+          /* The rest of the columns are all to the right of the exposed
+           * area. */
+	  if (cell_offset > event->area.x + event->area.width)
+	    break;
+
           if (tree_view->priv->selection->type == PSPP_SHEET_SELECTION_RECTANGLE)
             selected_column = column->selected && column->selectable;
           else
@@ -1866,12 +1866,56 @@ on_case_change (PsppireDataStore *data_store, gint row,
   gtk_widget_queue_draw (GTK_WIDGET (data_sheet));
 }
 
+/* Largest change in the number of cases that on_backend_changed()
+   applies to the existing model row by row.  Beyond this, replacing
+   the model is cheaper. */
+#define MAX_INCREMENTAL_ROWS 1000
+
 static void
 on_backend_changed (PsppireDataStore *data_store,
                     PsppireDataSheet *data_sheet)
 {
+  PsppireEmptyListStore *empty_list_store;
+  GtkTreeModel *tree_model;
+  gint old_n_rows, new_n_rows;
+
   g_return_if_fail (data_store == data_sheet->data_store);
-  refresh_model (data_sheet);
+
+  tree_model = pspp_sheet_view_get_model (PSPP_SHEET_VIEW (data_sheet));
+  if (tree_model == NULL)
+    {
+      refresh_model (data_sheet);
+      return;
+    }
+
+  /* The model holds only a row count, with the data itself fetched from
+     the data store as rows are drawn.  Thus, when only a few cases were
+     added or removed, e.g. by a transformation that added a variable,
+     it is enough to adjust the row count at the end and redraw, keeping
+     the view's scroll position, cursor, and selection. */
+  empty_list_store = PSPPIRE_EMPTY_LIST_STORE (tree_model);
+  old_n_rows = psppire_empty_list_store_get_n_rows (empty_list_store);
+  new_n_rows = psppire_data_store_get_case_count (data_store) + 1;
+  if (ABS (new_n_rows - old_n_rows) > MAX_INCREMENTAL_ROWS)
+    {
+      refresh_model (data_sheet);
+      return;
+    }
+
+  pspp_sheet_view_stop_editing (PSPP_SHEET_VIEW (data_sheet), TRUE);
+  for (; old_n_rows < new_n_rows; old_n_rows++)
+    {
+      psppire_empty_list_store_set_n_rows (empty_list_store, old_n_rows + 1);
+      psppire_empty_list_store_row_inserted (empty_list_store,
+                                             old_n_rows - 1);
+    }
+  for (; old_n_rows > new_n_rows; old_n_rows--)
+    {
+      psppire_empty_list_store_set_n_rows (empty_list_store, old_n_rows - 1);
+      psppire_empty_list_store_row_deleted (empty_list_store,
+                                            old_n_rows - 2);
+    }
+  gtk_widget_queue_draw (GTK_WIDGET (data_sheet));
 }
 
 static void
@@ -193,6 +193,7 @@ psppire_data_store_init (PsppireDataStore *data_store)
   data_store->dict = NULL;
   data_store->datasheet = NULL;
   data_store->dispose_has_run = FALSE;
+  data_store->read_ahead_id = 0;
 }
 
 /*
@@ -287,16 +288,50 @@ psppire_data_store_new (PsppireDict *dict)
   return retval;
 }
 
+/* Number of rows that read_ahead_idle() reads at a time.  Small
+   enough that the GUI stays responsive while it runs. */
+#define READ_AHEAD_ROWS 1000
+
+/* Idle callback that gradually reads the casereader backing DS_'s
+   datasheet into memory, so that scrolling or jumping far into a large
+   data file later does not block while every earlier case is decoded. */
+static gboolean
+read_ahead_idle (gpointer ds_)
+{
+  PsppireDataStore *ds = ds_;
+
+  if (ds->datasheet != NULL
+      && datasheet_read_ahead (ds->datasheet, READ_AHEAD_ROWS))
+    return TRUE;
+
+  ds->read_ahead_id = 0;
+  return FALSE;
+}
+
+static void
+stop_read_ahead (PsppireDataStore *ds)
+{
+  if (ds->read_ahead_id != 0)
+    {
+      g_source_remove (ds->read_ahead_id);
+      ds->read_ahead_id = 0;
+    }
+}
+
 void
 psppire_data_store_set_reader (PsppireDataStore *ds,
 			       struct casereader *reader)
 {
   gint i;
 
+  stop_read_ahead (ds);
   if ( ds->datasheet)
     datasheet_destroy (ds->datasheet);
 
   ds->datasheet = datasheet_create (reader);
+  if (reader != NULL)
+    ds->read_ahead_id = g_idle_add_full (G_PRIORITY_LOW, read_ahead_idle,
+                                         ds, NULL);
 
   if ( ds->dict )
     for (i = 0 ; i < n_dict_signals; ++i )
@@ -374,6 +409,7 @@ psppire_data_store_finalize (GObject *object)
 {
   PsppireDataStore *ds = PSPPIRE_DATA_STORE (object);
 
+  stop_read_ahead (ds);
   if (ds->datasheet)
     {
       datasheet_destroy (ds->datasheet);
@@ -510,6 +546,7 @@ psppire_data_store_set_string (PsppireDataStore *store,
 void
 psppire_data_store_clear (PsppireDataStore *ds)
 {
+  stop_read_ahead (ds);
   datasheet_destroy (ds->datasheet);
   ds->datasheet = NULL;
 
@@ -534,6 +571,7 @@ psppire_data_store_get_reader (PsppireDataStore *ds)
 				ds->dict_handler_id[i]);
       }
 
+  stop_read_ahead (ds);
   reader = datasheet_make_reader (ds->datasheet);
 
   /* We must not reference this again */
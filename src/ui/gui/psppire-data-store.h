@@ -74,6 +74,7 @@ struct _PsppireDataStore
   struct datasheet *datasheet;
 
   gint dict_handler_id [n_dict_signals];
+  guint read_ahead_id;          /* Idle source that reads ahead, or 0. */
 };
 
 struct _PsppireDataStoreClass
@@ -295,6 +295,7 @@ void
 psppire_dict_replace_dictionary (PsppireDict *dict, struct dictionary *d)
 {
   struct variable *var =  dict_get_weight (d);
+  gboolean same_dict = dict->dict == d;
 
   dict->dict = d;
 
@@ -307,7 +308,12 @@ psppire_dict_replace_dictionary (PsppireDict *dict, struct dictionary *d)
 
   dict_set_callbacks (dict->dict, &gui_callbacks, dict);
 
-  g_signal_emit (dict, signals [BACKEND_CHANGED], 0);
+  /* If D is the dictionary we already had, then its callbacks have
+     already told our clients about each variable that was inserted,
+     deleted, or changed, so there is no need to make them reload
+     everything. */
+  if (!same_dict)
+    g_signal_emit (dict, signals [BACKEND_CHANGED], 0);
 }
 
 
@@ -1,6 +1,7 @@
 ## Process this file with automake to produce Makefile.in  -*- makefile -*-
 
 check_PROGRAMS += \
+	tests/data/casebatch-test \
 	tests/data/datasheet-test \
 	tests/data/sack \
 	tests/data/inexactify \
@@ -31,17 +32,28 @@ check_PROGRAMS += \
 	tests/libpspp/tower-test \
 	tests/libpspp/u8-istream-test \
 	tests/libpspp/zip-test \
+	tests/math/covariance-test \
 	tests/output/render-test \
 	tests/ui/syntax-gen-test
 
 
 check-programs: $(check_PROGRAMS)
 
+tests_data_casebatch_test_SOURCES = \
+	tests/data/casebatch-test.c
+tests_data_casebatch_test_LDADD = src/libpspp-core.la
+tests_data_casebatch_test_CFLAGS = $(AM_CFLAGS)
+
 tests_data_datasheet_test_SOURCES = \
 	tests/data/datasheet-test.c
 tests_data_datasheet_test_LDADD = src/libpspp-core.la
 tests_data_datasheet_test_CFLAGS = $(AM_CFLAGS)
 
+tests_math_covariance_test_SOURCES = \
+	tests/math/covariance-test.c
+tests_math_covariance_test_LDADD = src/libpspp-core.la
+tests_math_covariance_test_CFLAGS = $(AM_CFLAGS)
+
 tests_data_sack_SOURCES = \
 	tests/data/sack.c
 tests_data_sack_LDADD = src/libpspp-core.la 
@@ -256,6 +268,7 @@ EXTRA_DIST += \
 
 TESTSUITE_AT = \
 	tests/data/calendar.at \
+	tests/data/casebatch.at \
 	tests/data/data-in.at \
 	tests/data/data-out.at \
 	tests/data/datasheet-test.at \
@@ -310,6 +323,7 @@ TESTSUITE_AT = \
 	tests/language/lexer/variable-parser.at \
 	tests/language/stats/aggregate.at \
 	tests/language/stats/autorecode.at \
+	tests/language/stats/bootstrap.at \
 	tests/language/stats/correlations.at \
 	tests/language/stats/crosstabs.at \
 	tests/language/stats/descriptives.at \
@@ -367,6 +381,7 @@ TESTSUITE_AT = \
 	tests/libpspp/tower.at \
 	tests/libpspp/u8-istream.at \
 	tests/libpspp/zip.at \
+	tests/math/covariance.at \
 	tests/math/moments.at \
 	tests/math/randist.at \
 	tests/output/ascii.at \
@@ -381,7 +396,7 @@ TESTSUITE_AT = \
 
 TESTSUITE = $(srcdir)/tests/testsuite
 DISTCLEANFILES += tests/atconfig tests/atlocal $(TESTSUITE)
-AUTOTEST_PATH = tests/data:tests/language/lexer:tests/libpspp:tests/output:src/ui/terminal:utilities
+AUTOTEST_PATH = tests/data:tests/language/lexer:tests/libpspp:tests/math:tests/output:src/ui/terminal:utilities
 
 $(srcdir)/tests/testsuite.at: tests/testsuite.in tests/automake.mk
 	$(AM_V_GEN)cp $< $@
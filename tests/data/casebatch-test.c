@@ -0,0 +1,168 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Reads a data file and prints its cases, one per line, either a case
+   at a time with casereader_read() or a batch at a time with
+   casereader_read_batch().  The output is the same either way, so
+   that comparing the two checks reading by batch.
+
+   Usage: casebatch-test FILE [CAPACITY [fallback]]
+
+   Without CAPACITY, reads FILE a case at a time.  With CAPACITY, reads
+   it in batches of at most that many cases.  With "fallback", the
+   reader is wrapped in a filter that has no batch support, so that
+   casereader_read_batch() has to read a case at a time itself. */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data/any-reader.h"
+#include "data/casebatch.h"
+#include "data/casereader.h"
+#include "data/caseproto.h"
+#include "data/dictionary.h"
+#include "data/file-handle-def.h"
+#include "data/settings.h"
+#include "data/val-type.h"
+#include "libpspp/i18n.h"
+
+#include "gl/error.h"
+#include "gl/progname.h"
+
+static void print_num (double);
+static void print_str (const uint8_t *, int width);
+
+static bool
+include_all (const struct ccase *c UNUSED, void *aux UNUSED)
+{
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const struct caseproto *proto;
+  struct casereader *reader;
+  struct file_handle *fh;
+  struct dictionary *dict;
+  size_t n_widths;
+  bool ok;
+
+  set_program_name (argv[0]);
+  if (argc < 2 || argc > 4
+      || (argc == 4 && strcmp (argv[3], "fallback")))
+    error (1, 0, "usage: %s FILE [CAPACITY [fallback]]", program_name);
+
+  i18n_init ();
+  fh_init ();
+  settings_init ();
+
+  fh = fh_create_file (NULL, argv[1], fh_default_properties ());
+  reader = any_reader_open_and_decode (fh, NULL, &dict, NULL);
+  if (reader == NULL)
+    error (1, 0, "%s: could not read file", argv[1]);
+  if (argc == 4)
+    reader = casereader_create_filter_func (reader, include_all, NULL,
+                                            NULL, NULL);
+
+  proto = casereader_get_proto (reader);
+  n_widths = caseproto_get_n_widths (proto);
+  if (argc == 2)
+    {
+      struct ccase *c;
+
+      for (; (c = casereader_read (reader)) != NULL; case_unref (c))
+        {
+          size_t i;
+
+          for (i = 0; i < n_widths; i++)
+            {
+              int width = caseproto_get_width (proto, i);
+
+              if (i > 0)
+                putchar (' ');
+              if (width == 0)
+                print_num (case_num_idx (c, i));
+              else
+                print_str (case_str_idx (c, i), width);
+            }
+          putchar ('\n');
+        }
+    }
+  else
+    {
+      struct casebatch *batch;
+      int capacity = atoi (argv[2]);
+      size_t n;
+
+      if (capacity <= 0)
+        error (1, 0, "CAPACITY must be positive");
+
+      batch = casebatch_create (proto, capacity);
+      while ((n = casereader_read_batch (reader, batch)) > 0)
+        {
+          size_t row;
+
+          if (n != casebatch_get_n_cases (batch))
+            error (1, 0, "batch has %zu cases but %zu were read",
+                   casebatch_get_n_cases (batch), n);
+          for (row = 0; row < n; row++)
+            {
+              size_t i;
+
+              for (i = 0; i < n_widths; i++)
+                {
+                  int width = caseproto_get_width (proto, i);
+
+                  if (i > 0)
+                    putchar (' ');
+                  if (width == 0)
+                    print_num (casebatch_num_column (batch, i)[row]);
+                  else
+                    print_str (casebatch_str (batch, i, row), width);
+                }
+              putchar ('\n');
+            }
+        }
+      casebatch_destroy (batch);
+    }
+
+  ok = casereader_destroy (reader);
+  dict_destroy (dict);
+  fh_unref (fh);
+  fh_done ();
+  i18n_done ();
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+print_num (double x)
+{
+  if (x == SYSMIS)
+    putchar ('.');
+  else
+    printf ("%g", x);
+}
+
+static void
+print_str (const uint8_t *s, int width)
+{
+  printf ("'%.*s'", width, (const char *) s);
+}
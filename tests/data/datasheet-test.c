@@ -19,7 +19,9 @@
 #include <data/datasheet.h>
 
 #include <ctype.h>
+#include <errno.h>
 #include <float.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -28,6 +30,7 @@
 #include <data/casereader.h>
 #include <data/casewriter.h>
 #include <data/lazy-casereader.h>
+#include <data/settings.h>
 #include <libpspp/argv-parser.h>
 #include <libpspp/array.h>
 #include <libpspp/assertion.h>
@@ -37,12 +40,14 @@
 #include <libpspp/range-set.h>
 #include <libpspp/str.h>
 #include <libpspp/taint.h>
+#include <libpspp/temp-file.h>
 #include <libpspp/tower.h>
 
 #include "error.h"
 #include "minmax.h"
 #include "progname.h"
 #include "xalloc.h"
+#include "xvasprintf.h"
 
 /* lazy_casereader callback function to instantiate a casereader
    from the datasheet. */
@@ -56,7 +61,7 @@ lazy_callback (void *ds_)
 
 /* Maximum size of datasheet supported for model checking
    purposes. */
-#define MAX_ROWS 5
+#define MAX_ROWS 6
 #define MAX_COLS 5
 #define MAX_WIDTHS 5
 
@@ -71,6 +76,8 @@ struct datasheet_test_params
     int n_backing_cols;           /* Number of columns of backing store. */
     int widths[MAX_WIDTHS];     /* Allowed column widths. */
     int n_widths;
+    int compaction_threshold;   /* Compaction threshold, -1 for default. */
+    bool compaction_fails;      /* Make compaction fail with I/O error? */
 
     /* State. */
     unsigned int next_value;
@@ -176,6 +183,41 @@ check_datasheet_casereader (struct mc *mc, struct casereader *reader,
     }
 }
 
+/* Number of rows that a datasheet keeps in memory with
+   --compaction=fail, which sets the smallest possible workspace. */
+#define COMPACTION_FAIL_MEMORY_ROWS 4
+
+/* Renames directory OLD_NAME to NEW_NAME, exiting on failure. */
+static void
+rename_dir (const char *old_name, const char *new_name)
+{
+  if (rename (old_name, new_name) != 0)
+    error (1, errno, "renaming \"%s\" to \"%s\"", old_name, new_name);
+}
+
+/* Calls datasheet_make_reader (DS) with the temporary file directory
+   renamed out of the way, so that creating a temporary file fails.
+   Temporary files that are already open keep working, so this only
+   makes compacting DS fail with an I/O error, and only when the
+   compacted copy needs more rows than fit in memory. */
+static struct casereader *
+make_reader_without_temp_files (struct datasheet *ds)
+{
+  const char *dir = temp_dir_name ();
+  struct casereader *reader;
+  char *hidden;
+
+  if (dir == NULL)
+    error (1, 0, "could not create temporary directory");
+  hidden = xasprintf ("%s.hidden", dir);
+  rename_dir (dir, hidden);
+  reader = datasheet_make_reader (ds);
+  rename_dir (hidden, dir);
+  free (hidden);
+
+  return reader;
+}
+
 /* Checks that datasheet DS contains has N_ROWS rows, N_COLUMNS
    columns, and the same contents as ARRAY, reporting any
    mismatches via mc_error.  Then, adds DS to MC as a new state. */
@@ -184,10 +226,12 @@ check_datasheet (struct mc *mc, struct datasheet *ds,
                  union value array[MAX_ROWS][MAX_COLS],
                  size_t n_rows, const struct caseproto *proto)
 {
+  struct datasheet_test_params *params = mc_get_aux (mc);
   size_t n_columns = caseproto_get_n_widths (proto);
   struct datasheet *ds2;
   struct casereader *reader;
   unsigned long int serial = 0;
+  bool expect_error;
 
   assert (n_rows < MAX_ROWS);
   assert (n_columns < MAX_COLS);
@@ -281,9 +325,19 @@ check_datasheet (struct mc *mc, struct datasheet *ds,
     }
 
   /* Check that datasheet contents are correct when read through
-     casereader. */
+     casereader.  With --compaction=fail, compacting a datasheet with
+     more rows than fit in memory fails, which must taint the
+     casereader but leave the data intact. */
   ds2 = clone_datasheet (ds);
-  reader = datasheet_make_reader (ds2);
+  reader = (params->compaction_fails
+            ? make_reader_without_temp_files (ds2)
+            : datasheet_make_reader (ds2));
+  expect_error = (params->compaction_fails
+                  && n_rows > COMPACTION_FAIL_MEMORY_ROWS && n_columns > 0);
+  if (casereader_error (reader) != expect_error)
+    mc_error (mc, expect_error
+              ? "casereader not tainted by failed compaction"
+              : "casereader unexpectedly tainted");
   check_datasheet_casereader (mc, reader, array, n_rows, proto);
   casereader_destroy (reader);
 
@@ -731,6 +785,24 @@ datasheet_mc_mutate (struct mc *mc, const void *ods_)
             release_data (n_rows, oproto, data);
           }
 
+  /* Read ahead all possible numbers of rows from the backing
+     casereader, which must not change the datasheet's contents,
+     whatever columns and rows have been inserted or deleted. */
+  for (cnt = 1; cnt <= MAX (params->backing_rows, 1); cnt++)
+    if (mc_include_state (mc))
+      {
+        struct datasheet *ds;
+
+        clone_model (ods, odata, &ds, data);
+        mc_name_operation (mc, "read ahead %zu rows", cnt);
+
+        if (datasheet_read_ahead (ds, cnt) && params->backing_rows == 0)
+          mc_error (mc, "read ahead without backing casereader");
+
+        check_datasheet (mc, ds, data, n_rows, oproto);
+        release_data (n_rows, oproto, data);
+      }
+
   release_data (n_rows, oproto, odata);
 }
 
@@ -749,6 +821,7 @@ enum
     OPT_BACKING_ROWS,
     OPT_BACKING_WIDTHS,
     OPT_WIDTHS,
+    OPT_COMPACTION,
     OPT_HELP,
     N_DATASHEET_OPTIONS
   };
@@ -760,6 +833,7 @@ static const struct argv_option datasheet_argv_options[N_DATASHEET_OPTIONS] =
     {"backing-rows", 0, required_argument, OPT_BACKING_ROWS},
     {"backing-widths", 0, required_argument, OPT_BACKING_WIDTHS},
     {"widths", 0, required_argument, OPT_WIDTHS},
+    {"compaction", 0, required_argument, OPT_COMPACTION},
     {"help", 'h', no_argument, OPT_HELP},
   };
 
@@ -835,6 +909,21 @@ datasheet_option_callback (int id, void *params_)
       }
       break;
 
+    case OPT_COMPACTION:
+      params->compaction_fails = false;
+      if (!strcmp (optarg, "auto"))
+        params->compaction_threshold = -1;
+      else if (!strcmp (optarg, "always"))
+        params->compaction_threshold = 0;
+      else if (!strcmp (optarg, "fail"))
+        {
+          params->compaction_threshold = 0;
+          params->compaction_fails = true;
+        }
+      else
+        error (1, 0, "--compaction argument must be auto, always, or fail");
+      break;
+
     case OPT_HELP:
       usage ();
       break;
@@ -855,7 +944,10 @@ usage (void)
           "  --backing-rows=N     Rows of backing store (0...max_rows, 0)\n"
           "  --backing-widths=W[,W]...  Backing store widths to test (0=num)\n"
           "  --widths=W[,W]...    Column widths to test, where 0=numeric,\n"
-          "                       other values are string widths (0,1,11)\n",
+          "                       other values are string widths (0,1,11)\n"
+          "  --compaction=MODE    When readers compact the datasheet: auto,\n"
+          "                       always, or fail (always, with I/O error\n"
+          "                       beyond 4 rows)\n",
           program_name, program_name);
   mc_options_usage ();
   fputs ("\nOther options:\n"
@@ -893,6 +985,8 @@ main (int argc, char *argv[])
   params.widths[1] = 1;
   params.widths[2] = 11;
   params.n_widths = 3;
+  params.compaction_threshold = -1;
+  params.compaction_fails = false;
   params.next_value = 1;
 
   /* Parse comand line. */
@@ -911,6 +1005,10 @@ main (int argc, char *argv[])
   params.max_cols = MIN (params.max_cols, MAX_COLS);
   params.backing_rows = MIN (params.backing_rows, params.max_rows);
   params.n_backing_cols = MIN (params.n_backing_cols, params.max_cols);
+  if (params.compaction_threshold >= 0)
+    datasheet_set_compaction_threshold (params.compaction_threshold);
+  if (params.compaction_fails)
+    settings_set_workspace (1);
   mc_options_set_aux (options, &params);
   results = mc_run (&datasheet_mc_class, options);
 
@@ -940,6 +1038,10 @@ main (int argc, char *argv[])
             printf (",");
           printf ("%d", params.widths[i]);
         }
+      printf (" --compaction=%s",
+              (params.compaction_fails ? "fail"
+               : params.compaction_threshold == 0 ? "always"
+               : "auto"));
       printf ("\n\n");
       mc_results_print (results, stdout);
     }
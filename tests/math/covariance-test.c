@@ -0,0 +1,185 @@
+/* PSPP - a program for statistical analysis.
+   Copyright (C) 2014 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Accumulates a fixed, weighted data set with some missing values into
+   a covariance and prints the results.  The cases are divided into
+   N_PARTS consecutive partitions, each accumulated into a separate
+   clone of an empty covariance and then combined with
+   covariance_merge().  The output does not depend on N_PARTS, so that
+   comparing the output for different N_PARTS checks merging.
+
+   Usage: covariance-test 1|2 N_PARTS
+
+   The first argument is the number of passes. */
+
+#include <config.h>
+
+#include <gsl/gsl_matrix.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "data/case.h"
+#include "data/caseproto.h"
+#include "data/dictionary.h"
+#include "data/val-type.h"
+#include "data/variable.h"
+#include "math/covariance.h"
+#include "math/moments.h"
+
+#include "gl/error.h"
+#include "gl/progname.h"
+#include "gl/xalloc.h"
+
+#define N_VARS 3
+#define N_CASES 53
+
+static struct ccase **make_cases (struct dictionary *,
+                                  const struct variable *vars[N_VARS],
+                                  const struct variable *wv);
+static void accumulate_parts (struct covariance *cov,
+                              const struct covariance *template,
+                              struct ccase **cases, int n_parts,
+                              void (*) (struct covariance *,
+                                        const struct ccase *));
+static void print_matrix (const char *title, const gsl_matrix *);
+
+int
+main (int argc, char *argv[])
+{
+  const struct variable *vars[N_VARS];
+  const struct variable *wv;
+  struct covariance *template;
+  struct covariance *cov;
+  struct dictionary *dict;
+  struct ccase **cases;
+  gsl_matrix *matrix;
+  int passes, n_parts;
+  size_t i;
+
+  set_program_name (argv[0]);
+  if (argc != 3)
+    error (1, 0, "usage: %s 1|2 N_PARTS", program_name);
+  passes = atoi (argv[1]);
+  n_parts = atoi (argv[2]);
+  if ((passes != 1 && passes != 2) || n_parts < 1 || n_parts > N_CASES)
+    error (1, 0, "usage: %s 1|2 N_PARTS", program_name);
+
+  dict = dict_create ("UTF-8");
+  vars[0] = dict_create_var_assert (dict, "x", 0);
+  vars[1] = dict_create_var_assert (dict, "y", 0);
+  vars[2] = dict_create_var_assert (dict, "z", 0);
+  wv = dict_create_var_assert (dict, "w", 0);
+  cases = make_cases (dict, vars, wv);
+
+  cov = (passes == 1
+         ? covariance_1pass_create (N_VARS, vars, wv, MV_ANY)
+         : covariance_2pass_create (N_VARS, vars, NULL, wv, MV_ANY));
+  template = covariance_clone (cov);
+  if (passes == 1)
+    accumulate_parts (cov, template, cases, n_parts, covariance_accumulate);
+  else
+    {
+      accumulate_parts (cov, template, cases, n_parts,
+                        covariance_accumulate_pass1);
+
+      /* Each part of the second pass must start from the merged
+         results of the first pass. */
+      covariance_destroy (template);
+      template = covariance_clone (cov);
+      accumulate_parts (cov, template, cases, n_parts,
+                        covariance_accumulate_pass2);
+    }
+  covariance_destroy (template);
+
+  matrix = covariance_calculate (cov);
+  print_matrix ("covariance", matrix);
+  gsl_matrix_free (matrix);
+  print_matrix ("n", covariance_moments (cov, MOMENT_NONE));
+  print_matrix ("mean", covariance_moments (cov, MOMENT_MEAN));
+  print_matrix ("variance", covariance_moments (cov, MOMENT_VARIANCE));
+  covariance_destroy (cov);
+
+  for (i = 0; i < N_CASES; i++)
+    case_unref (cases[i]);
+  free (cases);
+  dict_destroy (dict);
+
+  return 0;
+}
+
+/* Returns N_CASES cases for DICT with values for VARS and WV that follow
+   a fixed pattern, with some of the values system-missing. */
+static struct ccase **
+make_cases (struct dictionary *dict, const struct variable *vars[N_VARS],
+            const struct variable *wv)
+{
+  struct ccase **cases = xnmalloc (N_CASES, sizeof *cases);
+  size_t i;
+
+  for (i = 0; i < N_CASES; i++)
+    {
+      struct ccase *c = case_create (dict_get_proto (dict));
+      double x = (i * 7) % 23;
+      double y = (i * 11) % 17 + x / 2;
+      double z = (i * 5) % 13 - y / 4;
+
+      case_data_rw (c, vars[0])->f = i % 10 == 3 ? SYSMIS : x;
+      case_data_rw (c, vars[1])->f = y;
+      case_data_rw (c, vars[2])->f = i % 7 == 5 ? SYSMIS : z;
+      case_data_rw (c, wv)->f = i % 3 + 0.5;
+      cases[i] = c;
+    }
+  return cases;
+}
+
+/* Divides CASES into N_PARTS consecutive parts, accumulates each part
+   with ACCUMULATE into a separate clone of TEMPLATE, and merges the
+   clones into COV. */
+static void
+accumulate_parts (struct covariance *cov, const struct covariance *template,
+                  struct ccase **cases, int n_parts,
+                  void (*accumulate) (struct covariance *,
+                                      const struct ccase *))
+{
+  int part;
+
+  for (part = 0; part < n_parts; part++)
+    {
+      struct covariance *clone = covariance_clone (template);
+      size_t start = (size_t) N_CASES * part / n_parts;
+      size_t end = (size_t) N_CASES * (part + 1) / n_parts;
+      size_t i;
+
+      for (i = start; i < end; i++)
+        accumulate (clone, cases[i]);
+      covariance_merge (cov, clone);
+      covariance_destroy (clone);
+    }
+}
+
+static void
+print_matrix (const char *title, const gsl_matrix *m)
+{
+  size_t i, j;
+
+  printf ("%s:\n", title);
+  for (i = 0; i < m->size1; i++)
+    {
+      for (j = 0; j < m->size2; j++)
+        printf (" %.8g", gsl_matrix_get (m, i, j));
+      putchar ('\n');
+    }
+}